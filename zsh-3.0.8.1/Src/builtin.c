@@ -179,6 +179,7 @@ execbuiltin(LinkList args, Builtin bn)
 	while (*oargv)
 	    fprintf(xtrerr, " %s", *oargv++);
 	fputc('\n', xtrerr);
+	fflush(stdout);
 	fflush(xtrerr);
     }
     zsfree(xarg);
@@ -229,6 +230,11 @@ bin_enable(char *name, char **argv, char *ops, int func)
 	return 0;
     }
 
+    /* Strings parsed with the old aliases or reserved words *
+     * may now be parsed differently.                        */
+    if (ht == aliastab || ht == reswdtab)
+	parsecachetab->emptytable(parsecachetab);
+
     /* With -m option, treat arguments as glob patterns. */
     if (ops['m']) {
 	for (; *argv; argv++) {
@@ -535,6 +541,37 @@ bin_fg(char *name, char **argv, char *ops, int func)
 
     setcurjob();
 
+    if (func == BIN_WAIT && ops['n']) {
+	/* Wait for whichever of the jobs given finishes first, *
+	 * or for any job if none are given.                    */
+	int *jobs = NULL, njobs = 0;
+
+	if (*argv) {
+	    jobs = (int *) ncalloc(arrlen(argv) * sizeof(int));
+	    for (; *argv; argv++) {
+		if (isanum(*argv)) {
+		    Job jn;
+		    Process pn;
+
+		    if (!findproc((pid_t) atoi(*argv), &jn, &pn)) {
+			zwarnnam(name, "pid %s is not a child of this shell",
+				 *argv, 0);
+			return 127;
+		    }
+		    job = jn - jobtab;
+		} else if ((job = getjob(*argv, name)) == -1)
+		    return 127;
+		jobs[njobs++] = job;
+	    }
+	}
+	if ((job = waitanyjob(jobs, njobs, &retval)) == -1)
+	    return errflag ? 1 : 127;
+	setiparam("REPLY", job);
+	/* report it as done, which also removes it */
+	printjob(jobtab + job, !!isset(LONGLISTJOBS), 1);
+	return retval;
+    }
+
     if (func == BIN_JOBS)
         /* If you immediately type "exit" after "jobs", this      *
          * will prevent zexit from complaining about stopped jobs */
@@ -553,7 +590,7 @@ bin_fg(char *name, char **argv, char *ops, int func)
 	    firstjob = curjob;
 	} else if (func == BIN_JOBS) {
 	    /* List jobs. */
-	    for (job = 0; job != MAXJOB; job++)
+	    for (job = 0; job != jobtabsize; job++)
 		if (job != thisjob && jobtab[job].stat) {
 		    if ((!ops['r'] && !ops['s']) ||
 			(ops['r'] && ops['s']) ||
@@ -563,7 +600,7 @@ bin_fg(char *name, char **argv, char *ops, int func)
 		}
 	    return 0;
 	} else {   /* Must be BIN_WAIT, so wait for all jobs */
-	    for (job = 0; job != MAXJOB; job++)
+	    for (job = 0; job != jobtabsize; job++)
 		if (job != thisjob && jobtab[job].stat)
 		    waitjob(job, SIGINT);
 	    return 0;
@@ -663,6 +700,7 @@ bin_fg(char *name, char **argv, char *ops, int func)
 	    {
 		static struct job zero;
 
+		unhashprocs(jobtab + job);
 		jobtab[job] = zero;
 		break;
 	    }
@@ -752,6 +790,9 @@ bin_kill(char *nam, char **argv, char *ops, int func)
     }
 
     setcurjob();
+    /* The shell may be among the processes signalled, and a fatal *
+     * signal would take anything still buffered with it.          */
+    fflush(stdout);
 
     /* Remaining arguments specify processes.  Loop over them, and send the
     signal (number sig) to each process. */
@@ -832,7 +873,7 @@ findjobnam(char *s)
 {
     int jobnum;
 
-    for (jobnum = MAXJOB - 1; jobnum >= 0; jobnum--)
+    for (jobnum = jobtabsize - 1; jobnum >= 0; jobnum--)
 	if (!(jobtab[jobnum].stat & (STAT_SUBJOB | STAT_NOPRINT)) &&
 	    jobtab[jobnum].stat && jobtab[jobnum].procs && jobnum != thisjob &&
 	    jobtab[jobnum].procs->text && strpfx(s, jobtab[jobnum].procs->text))
@@ -876,7 +917,7 @@ getjob(char *s, char *prog)
     /* a digit here means we have a job number */
     if (idigit(*s)) {
 	jobnum = atoi(s);
-	if (jobnum && jobnum < MAXJOB && jobtab[jobnum].stat &&
+	if (jobnum && jobnum < jobtabsize && jobtab[jobnum].stat &&
 	    !(jobtab[jobnum].stat & STAT_SUBJOB) && jobnum != thisjob) {
 	    returnval = jobnum;
 	    goto done;
@@ -889,7 +930,7 @@ getjob(char *s, char *prog)
     if (*s == '?') {
 	struct process *pn;
 
-	for (jobnum = MAXJOB - 1; jobnum >= 0; jobnum--)
+	for (jobnum = jobtabsize - 1; jobnum >= 0; jobnum--)
 	    if (jobtab[jobnum].stat && !(jobtab[jobnum].stat & STAT_SUBJOB) &&
 		jobnum != thisjob)
 		for (pn = jobtab[jobnum].procs; pn; pn = pn->next)
@@ -1371,7 +1412,7 @@ cd_new_pwd(int func, LinkNode dir)
     if ((l = getshfunc("chpwd"))) {
 	fflush(stdout);
 	fflush(stderr);
-	doshfunc(l, NULL, 0, 1);
+	doshfunc("chpwd", l, NULL, 0, 1);
     }
 
     dirstacksize = getiparam("DIRSTACKSIZE");
@@ -3525,9 +3566,12 @@ bin_hash(char *name, char **argv, char *ops, int func)
 	    return 1;
 	}
 
-	/* empty the hash table */
-	if (ops['r'])
+	/* empty the hash table, and forget the *
+	 * directories read by completion, too  */
+	if (ops['r']) {
 	    ht->emptytable(ht);
+	    dircachetab->emptytable(dircachetab);
+	}
 
 	/* fill the hash table in a standard way */
 	if (ops['f'])
@@ -3606,6 +3650,9 @@ bin_unhash(char *name, char **argv, char *ops, int func)
     else
 	ht = cmdnamtab;		/* external commands */
 
+    if (ht == aliastab)
+	parsecachetab->emptytable(parsecachetab);
+
     /* With -m option, treat arguments as glob patterns. *
      * "unhash -m '*'" is legal, but not recommended.    */
     if (ops['m']) {
@@ -3708,6 +3755,7 @@ bin_alias(char *name, char **argv, char *ops, int func)
 	if (asg->value && !ops['L']) {
 	    /* The argument is of the form foo=bar and we are not *
 	     * forcing a listing with -L, so define an alias      */
+	    parsecachetab->emptytable(parsecachetab);
 	    aliastab->addnode(aliastab, ztrdup(asg->name),
 		createaliasnode(ztrdup(asg->value), flags1));
 	} else if ((a = (Alias) aliastab->getnode(aliastab, asg->name))) {
@@ -4481,6 +4529,8 @@ bin_print(char *name, char **args, char *ops, int func)
 	    zwarnnam(name, "bad mode on fd", NULL, 0);
 	    return 1;
 	}
+	/* keep the order of output also going to stdout */
+	fflush(stdout);
     }
 
     /* -o and -O -- sort the arguments */
@@ -4846,8 +4896,10 @@ zexit(int val, int from_signal)
 	}
 	if (sigtrapped[SIGEXIT])
 	    dotrap(SIGEXIT);
-	if (mypid != getpid())
+	if (mypid != getpid()) {
+	    fflush(stdout);
 	    _exit(val);
+	}
 	else
 	    exit(val);
     } LASTALLOC;
@@ -4954,7 +5006,7 @@ bin_eval(char *nam, char **argv, char *ops, int func)
 {
     List list;
 
-    list = parse_string(zjoin(argv, ' '), 0);
+    list = parse_cached(zjoin(argv, ' '));
     if (!list) {
 	errflag = 0;
 	return 1;
@@ -4970,6 +5022,43 @@ bin_eval(char *nam, char **argv, char *ops, int func)
 static char *zbuf;
 static int readfd;
 
+/* Input to read is normally taken a byte at a time, so that no more *
+ * is consumed than is used:  the rest may be meant for some other   *
+ * command sharing the descriptor.  It is safe to read ahead into    *
+ * rdbuf when everything up to end of file is to be read anyway, or  *
+ * when readfd is a regular file, as we can then seek back to the    *
+ * end of what was used when we are done.                            */
+
+#define RDBUFSIZE 8192
+
+static char *rdbuf;
+static int rdbuffered, rdbufpos, rdbuflen;
+
+/* Decide whether the input about to be read may be buffered */
+
+static void
+startread(int toeof)
+{
+    struct stat st;
+
+    rdbufpos = rdbuflen = 0;
+    rdbuffered = !zbuf && (toeof ||
+			   (!fstat(readfd, &st) && S_ISREG(st.st_mode) &&
+			    lseek(readfd, (off_t)0, SEEK_CUR) != -1));
+    if (rdbuffered && !rdbuf)
+	rdbuf = (char *)zalloc(RDBUFSIZE);
+}
+
+/* Give back whatever was read ahead of the input actually used */
+
+static void
+endread(void)
+{
+    if (rdbuffered && rdbufpos < rdbuflen)
+	lseek(readfd, (off_t)(rdbufpos - rdbuflen), SEEK_CUR);
+    rdbuffered = 0;
+}
+
 /* Read a character from readfd, or from the buffer zbuf.  Return EOF on end of
 file/buffer. */
 
@@ -4987,6 +5076,7 @@ bin_read(char *name, char **args, char *ops, int func)
 {
     char *reply, *readpmpt;
     int bsiz, c = 0, gotnl = 0, al = 0, first, nchars = 1, bslash, keys = 0;
+    int nlines = 0;
     int haso = 0;	/* true if /dev/tty has been opened specially */
     int isem = !strcmp(term, "emacs");
     char *buf, *bptr, *firstarg, *zbuforig;
@@ -4997,14 +5087,15 @@ bin_read(char *name, char **args, char *ops, int func)
 	if (!(nchars = atoi(*args)))
 	    nchars = 1;
 	args++;
-    }
+    } else if (ops['L'] && *args && idigit(**args))
+	nlines = atoi(*args++);
 
     firstarg = *args;
     if (*args && **args == '?')
 	args++;
     /* default result parameter */
-    reply = *args ? *args++ : ops['A'] ? "reply" : "REPLY";
-    if (ops['A'] && *args) {
+    reply = *args ? *args++ : (ops['A'] || ops['L']) ? "reply" : "REPLY";
+    if ((ops['A'] || ops['L']) && *args) {
 	zwarnnam(name, "only one array argument allowed", NULL, 0);
 	return 1;
     }
@@ -5046,6 +5137,8 @@ bin_read(char *name, char **args, char *ops, int func)
 	readfd = coprocin;
     else
 	readfd = 0;
+    /* output left in the buffer must appear before we wait for input */
+    fflush(stdout);
 
     /* handle prompt */
     if (firstarg) {
@@ -5232,6 +5325,94 @@ bin_read(char *name, char **args, char *ops, int func)
 	return readbuf[0] == 'n';
     }
 
+    /* option -L means read all remaining lines (or a given number of *
+     * them) into an array, each line becoming one element.            */
+    if (ops['L']) {
+	char **pp, **p;
+	LinkNode n;
+	sigset_t s;
+
+	zbuforig = zbuf = (!ops['z']) ? NULL :
+	    (nonempty(bufstack)) ? (char *) getlinknode(bufstack) : ztrdup("");
+	startread(!nlines);
+	s = child_unblock();
+	do {
+	    int any = 0;
+
+	    buf = bptr = (char *)zalloc(bsiz = 64);
+	    bslash = 0;
+	    for (;;) {
+		c = zread();
+		if (c == EOF)
+		    break;
+		any = 1;
+		/* \ at the end of a line indicates a continuation *
+		 * line, except in raw mode (-r option)            */
+		if (bslash && c == '\n') {
+		    bslash = 0;
+		    continue;
+		}
+		if (c == '\n')
+		    break;
+		if (!bslash && iwsep(c) && bptr == buf)
+		    continue;
+		bslash = c == '\\' && !bslash && !ops['r'];
+		if (bslash)
+		    continue;
+		if (imeta(c)) {
+		    *bptr++ = Meta;
+		    *bptr++ = c ^ 32;
+		} else
+		    *bptr++ = c;
+		/* increase the buffer size, if necessary */
+		if (bptr >= buf + bsiz - 1) {
+		    int blen = bptr - buf;
+
+		    buf = realloc(buf, bsiz *= 2);
+		    bptr = buf + blen;
+		}
+	    }
+	    if (!any) {
+		/* nothing after the last newline */
+		zfree(buf, bsiz);
+		break;
+	    }
+	    while (bptr > buf && iwsep(bptr[-1]))
+		bptr--;
+	    *bptr = '\0';
+	    addlinknode(readll, buf);
+	    al++;
+	} while (c != EOF && al != nlines);
+	signal_setmask(s);
+	endread();
+	if (zbuforig)
+	    zsfree(zbuforig);
+	else if (c == EOF && readfd == coprocin) {
+	    close(coprocin);
+	    close(coprocout);
+	    coprocin = coprocout = -1;
+	}
+
+	p = (ops['e'] ? (char **)NULL
+	     : (char **)zalloc((al + 1) * sizeof(char *)));
+
+	for (pp = p, n = firstnode(readll); n; incnode(n)) {
+	    if (ops['e'] || ops['E']) {
+		zputs((char *) getdata(n), stdout);
+		putchar('\n');
+	    }
+	    if (p)
+		*pp++ = (char *)getdata(n);
+	    else
+		zsfree(getdata(n));
+	}
+	if (p) {
+	    *pp++ = NULL;
+	    setaparam(reply, p);
+	}
+	return !al;
+    }
+
     /* All possible special types of input have been exhausted.  Take one line,
     and assign words to the parameters until they run out.  Leftover words go
     onto the last parameter.  If an array is specified, all the words become
@@ -5239,6 +5420,7 @@ bin_read(char *name, char **args, char *ops, int func)
 
     zbuforig = zbuf = (!ops['z']) ? NULL :
 	(nonempty(bufstack)) ? (char *) getlinknode(bufstack) : ztrdup("");
+    startread(0);
     first = 1;
     bslash = 0;
     while (*args || (ops['A'] && !gotnl)) {
@@ -5313,6 +5495,7 @@ bin_read(char *name, char **args, char *ops, int func)
 	char **pp, **p = NULL;
 	LinkNode n;
 
+	endread();
 	p = (ops['e'] ? (char **)NULL
 	     : (char **)zalloc((al + 1) * sizeof(char *)));
 
@@ -5373,6 +5556,7 @@ bin_read(char *name, char **args, char *ops, int func)
 	}
 	signal_setmask(s);
     }
+    endread();
     while (bptr > buf && iwsep(bptr[-1]))
 	bptr--;
     *bptr = '\0';
@@ -5406,7 +5590,8 @@ bin_read(char *name, char **args, char *ops, int func)
 int
 zread(void)
 {
-    char cc, retry = 0;
+    char cc, *ptr, retry = 0;
+    int cnt, len;
 
     /* use zbuf if possible */
     if (zbuf) {
@@ -5419,13 +5604,30 @@ zread(void)
 	    return (*zbuf) ? STOUC(*zbuf++) : EOF;
     }
     for (;;) {
-	/* read a character from readfd */
+	if (rdbuffered) {
+	    /* use what was read ahead, or read the next buffer full */
+	    if (rdbufpos < rdbuflen)
+		return STOUC(rdbuf[rdbufpos++]);
+	    rdbufpos = rdbuflen = 0;
+	    ptr = rdbuf;
+	    len = RDBUFSIZE;
+	} else {
+	    /* read a character from readfd */
+	    ptr = &cc;
+	    len = 1;
+	}
 #if defined(_WIN32)
-	switch (readfile(readfd, &cc, 1)) {
+	switch (cnt = readfile(readfd, ptr, len)) {
 #else
-	switch (read(readfd, &cc, 1)) {
+	switch (cnt = read(readfd, ptr, len)) {
 #endif
-	case 1:
+	case 0:
+	    break;
+	default:
+	    if (rdbuffered) {
+		rdbuflen = cnt;
+		continue;
+	    }
 	    /* return the character read */
 	    return STOUC(cc);
 	case -1:
@@ -5915,10 +6117,351 @@ bin_hashinfo(char *nam, char **args, char *ops, int func)
     printf("----------------------------------------------------\n");
     nameddirtab->printinfo(nameddirtab);
     printf("----------------------------------------------------\n");
+    parsecachetab->printinfo(parsecachetab);
+    printf("----------------------------------------------------\n");
+    dircachetab->printinfo(dircachetab);
+    printf("----------------------------------------------------\n");
     return 0;
 }
 #endif
 
+/**** function profiler ****/
+
+/* While profiling is on, every shell function call made through *
+ * doshfunc() is timed.  For each function the number of calls,   *
+ * the inclusive and the self (exclusive) time are kept, both as  *
+ * wall clock time and as CPU time of the shell and the children  *
+ * it reaped meanwhile.  Each function also keeps the list of its *
+ * callers, and the self time is also kept per call stack, which  *
+ * is what flame graph tools want.                                */
+
+typedef struct profent *Profent;
+typedef struct profarc *Profarc;
+typedef struct profframe *Profframe;
+
+/* node for the profile hash tables */
+
+struct profent {
+    HashNode next;		/* next in hash chain               */
+    char *nam;			/* function name or call stack      */
+    int flags;			/* CURRENTLY UNUSED                 */
+    long calls;			/* number of calls                  */
+    int active;			/* number of calls in progress      */
+    double total, self;		/* wall clock time in seconds       */
+    long tcpu, scpu;		/* CPU time in clock ticks          */
+    Profarc arcs;		/* list of callers                  */
+};
+
+/* a caller of a function */
+
+struct profarc {
+    Profarc next;
+    Profent from;		/* caller, NULL for top level       */
+    long calls;
+    double total;
+    long tcpu;
+};
+
+/* a function call in progress */
+
+struct profframe {
+    Profframe up;
+    Profent ent;		/* function called                  */
+    Profent stk;		/* entry for the call stack         */
+    double start, child;	/* wall clock time on entry, and    *
+				 * spent in functions called        */
+    long cpustart, cpuchild;	/* the same as CPU time             */
+};
+
+static HashTable proftab;	/* functions, by name                  */
+static HashTable profstktab;	/* call stacks as "outer;...;inner"    */
+static Profframe proftop;	/* innermost call in progress          */
+
+#define INITIAL_PROFTAB 31
+
+/* Get the wall clock time in seconds and the CPU time in clock ticks. */
+
+static double
+profclock(long *cpu)
+{
+    struct timeval tv;
+    struct timezone dummy_tz;
+    struct tms buf;
+
+    gettimeofday(&tv, &dummy_tz);
+    times(&buf);
+    *cpu = buf.tms_utime + buf.tms_stime + buf.tms_cutime + buf.tms_cstime;
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+freeprofnode(HashNode hn)
+{
+    Profent pe = (Profent) hn;
+    Profarc pa, pn;
+
+    for (pa = pe->arcs; pa; pa = pn) {
+	pn = pa->next;
+	zfree(pa, sizeof(struct profarc));
+    }
+    zsfree(pe->nam);
+    zfree(pe, sizeof(struct profent));
+}
+
+static HashTable
+newproftable(void)
+{
+    HashTable ht = newhashtable(INITIAL_PROFTAB);
+
+    ht->hash     = hasher;
+    ht->addnode  = addhashnode;
+    ht->getnode  = gethashnode2;
+    ht->getnode2 = gethashnode2;
+    ht->freenode = freeprofnode;
+    return ht;
+}
+
+/* Find the entry for nam, creating it if there is none. */
+
+static Profent
+getprofent(HashTable ht, char *nam)
+{
+    Profent pe;
+
+    if (!(pe = (Profent) ht->getnode(ht, nam))) {
+	pe = (Profent) zcalloc(sizeof *pe);
+	ht->addnode(ht, ztrdup(nam), pe);
+    }
+    return pe;
+}
+
+/* Start timing a call to the function nam.  Called from doshfunc(). */
+
+/**/
+void
+profenter(char *nam)
+{
+    Profframe pf = (Profframe) zalloc(sizeof *pf);
+    char *stk = nam;
+
+    if (!proftab) {
+	proftab = newproftable();
+	profstktab = newproftable();
+    }
+    pf->up = proftop;
+    pf->ent = getprofent(proftab, nam);
+    pf->ent->active++;
+    if (proftop) {
+	stk = (char *) halloc(strlen(proftop->stk->nam) + strlen(nam) + 2);
+	sprintf(stk, "%s;%s", proftop->stk->nam, nam);
+    }
+    pf->stk = getprofent(profstktab, stk);
+    pf->child = 0.0;
+    pf->cpuchild = 0;
+    pf->start = profclock(&pf->cpustart);
+    proftop = pf;
+}
+
+/* Finish timing the innermost function call in progress. */
+
+/**/
+void
+profleave(void)
+{
+    Profframe pf = proftop;
+    Profent pe = pf->ent, from = pf->up ? pf->up->ent : NULL;
+    Profarc pa;
+    double t;
+    long cpu;
+
+    t = profclock(&cpu) - pf->start;
+    cpu -= pf->cpustart;
+
+    pe->calls++;
+    pe->self += t - pf->child;
+    pe->scpu += cpu - pf->cpuchild;
+    pf->stk->calls++;
+    pf->stk->self += t - pf->child;
+    pf->stk->scpu += cpu - pf->cpuchild;
+    /* count the time of recursive calls only once */
+    if (!--pe->active) {
+	pe->total += t;
+	pe->tcpu += cpu;
+    }
+
+    for (pa = pe->arcs; pa && pa->from != from; pa = pa->next);
+    if (!pa) {
+	pa = (Profarc) zcalloc(sizeof *pa);
+	pa->from = from;
+	pa->next = pe->arcs;
+	pe->arcs = pa;
+    }
+    pa->calls++;
+    pa->total += t;
+    pa->tcpu += cpu;
+
+    if ((proftop = pf->up)) {
+	proftop->child += t;
+	proftop->cpuchild += cpu;
+    }
+    zfree(pf, sizeof(struct profframe));
+}
+
+/* Forget everything profiled so far.  Entries for calls in progress *
+ * are still needed when they return, so they are only zeroed.       */
+
+static void
+profclear(void)
+{
+    HashTable ht;
+    HashNode hn;
+    Profent pe;
+    Profarc pa, pn;
+    int i, j;
+
+    if (!proftab)
+	return;
+    if (!proftop) {
+	emptyhashtable(proftab, INITIAL_PROFTAB);
+	emptyhashtable(profstktab, INITIAL_PROFTAB);
+	return;
+    }
+    for (j = 0; j < 2; j++) {
+	ht = j ? profstktab : proftab;
+	for (i = 0; i < ht->hsize; i++)
+	    for (hn = ht->nodes[i]; hn; hn = hn->next) {
+		pe = (Profent) hn;
+		pe->calls = pe->tcpu = pe->scpu = 0;
+		pe->total = pe->self = 0.0;
+		for (pa = pe->arcs; pa; pa = pn) {
+		    pn = pa->next;
+		    zfree(pa, sizeof(struct profarc));
+		}
+		pe->arcs = NULL;
+	    }
+    }
+}
+
+/* how the report is sorted, see profcmp() */
+
+static int profsort;
+
+#define PROF_SELF  0
+#define PROF_TOTAL 1
+#define PROF_CALLS 2
+#define PROF_NAME  3
+
+static int
+profcmp(const void *a, const void *b)
+{
+    Profent pa = *(Profent *)a, pb = *(Profent *)b;
+    double d;
+
+    switch (profsort) {
+    case PROF_SELF:
+	d = pb->self - pa->self;
+	break;
+    case PROF_TOTAL:
+	d = pb->total - pa->total;
+	break;
+    case PROF_CALLS:
+	d = pb->calls - pa->calls;
+	break;
+    default:
+	d = 0.0;
+	break;
+    }
+    return d < 0.0 ? -1 : d > 0.0 ? 1 : strcmp(pa->nam, pb->nam);
+}
+
+/* Return the entries of a profile table in an array sorted as *
+ * given by profsort.  The array is on the heap.               */
+
+static Profent *
+profsorted(HashTable ht)
+{
+    Profent *tab = (Profent *) ncalloc((ht->ct + 1) * sizeof(Profent));
+    HashNode hn;
+    int i, n = 0;
+
+    for (i = 0; i < ht->hsize; i++)
+	for (hn = ht->nodes[i]; hn; hn = hn->next)
+	    if (((Profent) hn)->calls)
+		tab[n++] = (Profent) hn;
+    tab[n] = NULL;
+    qsort((void *) tab, n, sizeof(Profent), profcmp);
+    return tab;
+}
+
+/* zprof: control function profiling and report the results */
+
+/**/
+int
+bin_zprof(char *nam, char **argv, char *ops, int func)
+{
+    Profent *tab, *pp, pe;
+    Profarc pa;
+    double tck = (double) getclktck(), all = 0.0;
+
+    if (ops['e'] || ops['d'] || ops['c']) {
+	if (ops['e'] && ops['d']) {
+	    zwarnnam(nam, "-e and -d are mutually exclusive", NULL, 0);
+	    return 1;
+	}
+	if (ops['c'])
+	    profclear();
+	if (ops['e'] || ops['d'])
+	    profiling = ops['e'];
+	return 0;
+    }
+    if (!proftab)
+	return 0;
+
+    profsort = ops['t'] ? PROF_TOTAL : ops['n'] ? PROF_CALLS :
+	ops['a'] ? PROF_NAME : PROF_SELF;
+
+    /* Folded call stacks with the self time in microseconds, *
+     * as read by flamegraph.pl and similar tools.            */
+    if (ops['f']) {
+	for (pp = profsorted(profstktab); (pe = *pp); pp++) {
+	    zputs(pe->nam, stdout);
+	    printf(" %.0f\n", pe->self * 1000000.0);
+	}
+	return 0;
+    }
+
+    tab = profsorted(proftab);
+    for (pp = tab; *pp; pp++)
+	all += (*pp)->self;
+    printf("   calls    total     self  total%%   self%%  total cpu   self cpu  name\n");
+    for (pp = tab; (pe = *pp); pp++) {
+	printf("%8ld %8.3f %8.3f %6.2f%% %6.2f%% %10.3f %10.3f  ",
+	       pe->calls, pe->total, pe->self,
+	       all > 0.0 ? 100.0 * pe->total / all : 0.0,
+	       all > 0.0 ? 100.0 * pe->self / all : 0.0,
+	       pe->tcpu / tck, pe->scpu / tck);
+	zputs(pe->nam, stdout);
+	putchar('\n');
+    }
+
+    /* The callers of each function, with the calls *
+     * from each of them and their total time.      */
+    printf("\n   calls    total  total cpu  caller -> callee\n");
+    for (pp = tab; (pe = *pp); pp++)
+	for (pa = pe->arcs; pa; pa = pa->next) {
+	    printf("%8ld %8.3f %10.3f  ", pa->calls, pa->total,
+		   pa->tcpu / tck);
+	    if (pa->from)
+		zputs(pa->from->nam, stdout);
+	    else
+		fputs("(top level)", stdout);
+	    fputs(" -> ", stdout);
+	    zputs(pe->nam, stdout);
+	    putchar('\n');
+	}
+    return 0;
+}
+
 /**** utility functions -- should go in utils.c ****/
 
 /* Separate an argument into name=value parts, returning them in an     *
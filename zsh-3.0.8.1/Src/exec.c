@@ -57,6 +57,22 @@ parse_string(char *s, int ln)
     return l;
 }
 
+/* Parse a string that is likely to be seen again, using the *
+ * tree kept in the parse cache if there is one.             */
+
+/**/
+List
+parse_cached(char *s)
+{
+    List l;
+
+    if ((l = getparsecache(s)))
+	return l;
+    if ((l = parse_string(s, 0)) && !errflag)
+	addparsecache(s, l);
+    return l;
+}
+
 #ifdef HAVE_GETRLIMIT
 /**/
 int
@@ -96,10 +112,11 @@ zfork(void)
 {
     pid_t pid;
 
-    if (thisjob >= MAXJOB - 1) {
+    if (thisjob >= jobtabsize - 1 && !expandjobtab()) {
 	zerr("job table full", NULL, 0);
 	return -1;
     }
+    fflush(stdout);		/* or the child gets a copy of the buffer */
     pid = fork();
     if (pid == -1) {
 	zerr("fork failed: %e", NULL, errno);
@@ -360,7 +377,12 @@ execute(Cmdnam not_used_yet, int dash)
     }
 
     argv = makecline(args);
-    closem(3);
+    /* Close the copy of stderr made for xtrace output.  This must not *
+     * be closem(3): inside a shell function the fdtable entries of    *
+     * process substitutions are counted up, and may also reach 3.     */
+    if (xtrerr != stderr)
+	zclose(fileno(xtrerr));
+    fflush(stdout);
     child_unblock();
     if ((int) strlen(arg0) >= PATH_MAX) {
 	zerr("command too long: %s", arg0, 0);
@@ -573,7 +595,7 @@ execstring(char *s, int dont_change_job, int exiting)
     List list;
 
     pushheap();
-    if ((list = parse_string(s, 0)))
+    if ((list = parse_cached(s)))
 	execlist(list, dont_change_job, exiting);
     popheap();
 }
@@ -681,8 +703,10 @@ sublist_done:
 	    if (lastval && isset(ERREXIT)) {
 		if (sigtrapped[SIGEXIT])
 		    dotrap(SIGEXIT);
-		if (mypid != getpid())
+		if (mypid != getpid()) {
+		    fflush(stdout);
 		    _exit(lastval);
+		}
 		else
 		    exit(lastval);
 	    }
@@ -775,8 +799,10 @@ execpline(Sublist l, int how, int last1)
 	    Job jn = jobtab + newjob;
 	    int updated;
 
-	    if (newjob == list_pipe_job && list_pipe_child)
+	    if (newjob == list_pipe_job && list_pipe_child) {
+		fflush(stdout);
 		_exit(0);
+	    }
 
 	    lastwj = thisjob = newjob;
 
@@ -826,6 +852,8 @@ execpline(Sublist l, int how, int last1)
 		    updated = !!jobtab[thisjob].procs;
 		    waitjobs();
 		    child_block();
+		    /* traps run while waiting may have moved the job table */
+		    jn = jobtab + newjob;
 		} else
 		    updated = 0;
 		if (!updated &&
@@ -852,6 +880,7 @@ execpline(Sublist l, int how, int last1)
 			trashzle();
 			close(synch[0]);
 			close(synch[1]);
+			fflush(stdout);
 			putc('\n', stderr);
 			fprintf(stderr, "zsh: job can't be suspended\n");
 			fflush(stderr);
@@ -984,6 +1013,7 @@ execpline2(Pline pline, int how, int input, int output, int last1)
 		entersubsh(how, 2, 0);
 		close(synch[1]);
 		execcmd(pline->left, input, pipes[1], how, 0);
+		fflush(stdout);
 		_exit(lastval);
 	    }
 	} else {
@@ -1028,6 +1058,7 @@ makecline(LinkList list)
 		fputc(' ', xtrerr);
 	}
 	fputc('\n', xtrerr);
+	fflush(stdout);
 	fflush(xtrerr);
     } else {
 	for (node = firstnode(list); node; incnode(node))
@@ -1075,7 +1106,127 @@ clobber_open(struct redir *f)
 }
 
 /* size of buffer for tee and cat processes */
-#define TCBUFSIZE 4092
+#define TCBUFSIZE 65536
+
+/* Write all of buf to fd, as a pipe or terminal may take less at a *
+ * time.  Returns 0, or -1 on an error, after which fd is no use.   */
+
+static int
+tcwrite(int fd, char *buf, int len)
+{
+    int n;
+
+    while (len > 0)
+	if ((n = write(fd, buf, len)) > 0) {
+	    buf += n;
+	    len -= n;
+	} else if (n < 0 && errno != EINTR)
+	    return -1;
+    return 0;
+}
+
+#if defined(HAVE_SPLICE) && defined(HAVE_TEE)
+
+/* Move up to len bytes from the pipe in to out inside the kernel, *
+ * and return how many were moved:  fewer if out is something       *
+ * splice() does not write to, or has gone away.                    */
+
+static int
+splicen(int in, int out, int len)
+{
+    int n, moved = 0;
+
+    while (moved < len)
+	if ((n = splice(in, NULL, out, NULL, len - moved, SPLICE_F_MOVE)) > 0)
+	    moved += n;
+	else if (n == 0 || errno != EINTR)
+	    break;
+    return moved;
+}
+
+/* Read len bytes of the pipe in, which must all be there already, *
+ * and write them to *outp unless that is -1.  If the write fails, *
+ * *outp is set to -1 so that the fd is left alone from now on.    */
+
+static void
+copyn(int in, int *outp, int len, char *buf)
+{
+    int n;
+
+    while (len > 0)
+	if ((n = read(in, buf, len)) > 0) {
+	    if (*outp >= 0 && tcwrite(*outp, buf, n))
+		*outp = -1;
+	    len -= n;
+	} else if (n == 0 || errno != EINTR)
+	    break;
+}
+
+/* The tee process, without copying through user space.  Each fd  *
+ * but the last gets a tee() of what is in the pipe through a pipe *
+ * of our own, and then the last has the pipe itself spliced to    *
+ * it.  An fd splice() will not write to is written the usual way. *
+ * Returns nonzero if tee() cannot be used, leaving what it has not *
+ * passed on in the pipe for the caller to copy the usual way.      */
+
+static int
+teesplice(struct multio *mn, char *buf)
+{
+    int p[2], slow[MULTIOUNIT], i, len, n, last = mn->ct - 1;
+
+    if (pipe(p) == -1)
+	return 1;
+    for (i = 0; i < mn->ct; i++)
+	slow[i] = 0;
+    for (;;) {
+	while ((len = tee(mn->pipe, p[1], TCBUFSIZE, 0)) < 0 &&
+	       errno == EINTR);
+	if (len <= 0)
+	    break;
+	for (i = 0; i < last; i++) {
+	    if (i && (n = tee(mn->pipe, p[1], len, 0)) != len) {
+		/* a short tee():  the rest get this lot the usual way */
+		int none = -1;
+
+		if (n > 0)
+		    copyn(p[0], &none, n, buf);
+		break;
+	    }
+	    n = (mn->fds[i] >= 0 && !slow[i]) ?
+		splicen(p[0], mn->fds[i], len) : 0;
+	    if (!n)
+		slow[i] = 1;
+	    else if (n < len)
+		mn->fds[i] = -1;
+	    copyn(p[0], mn->fds + i, len - n, buf);
+	}
+	if (i < last) {
+	    int got = 0;
+
+	    while (got < len)
+		if ((n = read(mn->pipe, buf + got, len - got)) > 0)
+		    got += n;
+		else if (n == 0 || errno != EINTR)
+		    break;
+	    for (; i <= last; i++)
+		if (mn->fds[i] >= 0 && tcwrite(mn->fds[i], buf, got))
+		    mn->fds[i] = -1;
+	    continue;
+	}
+	n = (mn->fds[last] >= 0 && !slow[last]) ?
+	    splicen(mn->pipe, mn->fds[last], len) : 0;
+	if (!n)
+	    slow[last] = 1;
+	else if (n < len)
+	    mn->fds[last] = -1;
+	copyn(mn->pipe, mn->fds + last, len - n, buf);
+    }
+    close(p[0]);
+    close(p[1]);
+    return len < 0;
+}
+
+#endif
 
 /* close an multio (success) */
 
@@ -1108,14 +1259,30 @@ closemn(struct multio **mfds, int fd)
     closeallelse(mn);
     if (mn->rflag) {
 	/* tee process */
-	while ((len = read(mn->pipe, buf, TCBUFSIZE)) > 0)
+#if defined(HAVE_SPLICE) && defined(HAVE_TEE)
+	if (!teesplice(mn, buf))
+	    _exit(0);
+#endif
+	while ((len = read(mn->pipe, buf, TCBUFSIZE)) > 0 ||
+	       (len < 0 && errno == EINTR))
 	    for (i = 0; i < mn->ct; i++)
-		write(mn->fds[i], buf, len);
+		if (mn->fds[i] >= 0 && tcwrite(mn->fds[i], buf, len))
+		    mn->fds[i] = -1;
     } else {
 	/* cat process */
-	for (i = 0; i < mn->ct; i++)
-	    while ((len = read(mn->fds[i], buf, TCBUFSIZE)) > 0)
-		write(mn->pipe, buf, len);
+	for (i = 0; i < mn->ct; i++) {
+#if defined(HAVE_SPLICE) && defined(HAVE_TEE)
+	    while ((len = splice(mn->fds[i], NULL, mn->pipe, NULL,
+				 TCBUFSIZE, SPLICE_F_MOVE)) > 0 ||
+		   (len < 0 && errno == EINTR));
+	    if (!len)
+		continue;
+#endif
+	    while ((len = read(mn->fds[i], buf, TCBUFSIZE)) > 0 ||
+		   (len < 0 && errno == EINTR))
+		if (len > 0 && tcwrite(mn->pipe, buf, len))
+		    _exit(1);
+	}
     }
     _exit(0);
 }
@@ -1437,6 +1604,7 @@ execcmd(Cmd cmd, int input, int output, int how, int last1)
 			lastval = cmdoutval;
 		    if (isset(XTRACE)) {
 			fputc('\n', xtrerr);
+			fflush(stdout);
 			fflush(xtrerr);
 		    }
 		    return;
@@ -1808,6 +1976,7 @@ execcmd(Cmd cmd, int input, int output, int how, int last1)
 	lastval = errflag ? errflag : cmdoutval;
 	if (isset(XTRACE)) {
 	    fputc('\n', xtrerr);
+	    fflush(stdout);
 	    fflush(xtrerr);
 	}
     } else if (isset(EXECOPT) && !errflag) {
@@ -1879,9 +2048,15 @@ execcmd(Cmd cmd, int input, int output, int how, int last1)
 		closem(2);
 #endif
 		if (isset(PRINTEXITVALUE) && isset(SHINSTDIN) && lastval && !subsh) {
+		    fflush(stdout);
 		    fprintf(stderr, "zsh: exit %ld\n", (long)lastval);
 		}
-		fflush(stdout);
+		/* Output stays in the buffer, unless it goes to a  *
+		 * terminal or fd 1 is about to be put back.        */
+		if (!ttystdout)
+		    ttystdout = 1 + isatty(1);
+		if (save[1] != -2 || ttystdout > 1)
+		    fflush(stdout);
 		if (save[1] == -2) {
 		    if (ferror(stdout)) {
 			zerr("write error: %e", NULL, errno);
@@ -1893,8 +2068,10 @@ execcmd(Cmd cmd, int input, int output, int how, int last1)
 	    }
 
 	    if (cmd->flags & CFLAG_EXEC) {
-		if (subsh)
+		if (subsh) {
+		    fflush(stdout);
 		    _exit(lastval);
+		}
 
 		/* If we are exec'ing a command, and we are not in a subshell, *
 		 * then check if we should save the history file.              */
@@ -1948,8 +2125,10 @@ execcmd(Cmd cmd, int input, int output, int how, int last1)
     }
 
   err:
-    if (forked)
+    if (forked) {
+	fflush(stdout);
 	_exit(lastval);
+    }
     fixfds(save);
 
  done:
@@ -2240,10 +2419,36 @@ getherestr(struct redir *fn)
     untokenize(t);
     unmetafy(t, &len);
     t[len++] = '\n';
+#if defined(HAVE_MEMFD_CREATE) && defined(PATH_DEV_FD)
+    /* An anonymous file in memory is as seekable as one in /tmp, *
+     * but costs no trip to the file system and no cleaning up.   *
+     * Like the temporary file, it is opened again read-only for  *
+     * the command, which must not be able to write to its input. *
+     * Where opening the fd directory works like dup(), the new   *
+     * descriptor shares the old one's offset and access mode, so *
+     * it is rewound, and if it can still write we use /tmp.      */
+    if ((fd = memfd_create("zsh-here", 0)) != -1) {
+	char nam[sizeof(PATH_DEV_FD) + 12];
+	int rfd = -1;
+
+	if (!tcwrite(fd, t, len)) {
+	    sprintf(nam, "%s/%d", PATH_DEV_FD, fd);
+	    if ((rfd = open(nam, O_RDONLY)) != -1 &&
+		(lseek(rfd, (off_t)0, SEEK_SET) != 0 ||
+		 (fcntl(rfd, F_GETFL) & O_ACCMODE) != O_RDONLY)) {
+		close(rfd);
+		rfd = -1;
+	    }
+	}
+	close(fd);
+	if (rfd != -1)
+	    return rfd;
+    }
+#endif
     s = gettempname();
     if (!s || (fd = open(s, O_CREAT | O_WRONLY | O_EXCL, 0600)) == -1)
 	return -1;
-    write(fd, t, len);
+    tcwrite(fd, t, len);
     close(fd);
 #if defined(_WIN32)
     fd = open(s, O_RDONLY | O_TEMPORARY);
@@ -2269,7 +2474,7 @@ getoutput(char *cmd, int qt)
     Cmd c;
     Redir r;
 
-    if (!(list = parse_string(cmd, 0)))
+    if (!(list = parse_cached(cmd)))
 	return NULL;
     if (list != &dummy_list && !list->right && !list->left->flags &&
 	list->left->type == END && list->left->left->type == END &&
@@ -2322,6 +2527,7 @@ getoutput(char *cmd, int qt)
     opts[MONITOR] = 0;
     entersubsh(Z_SYNC, 1, 0);
     execlist(list, 0, 1);
+    fflush(stdout);
     close(1);
     _exit(lastval);
     zerr("exit returned in child!!", NULL, 0);
@@ -2419,23 +2625,38 @@ getoutputfile(char *cmd)
     pid_t pid;
     char *nam;
     List list;
-    int fd;
+    int fd, memfd = 0;
 
     if (thisjob == -1)
 	return NULL;
     if (!(list = parsecmd(cmd)))
 	return NULL;
-    if (!(nam = gettempname()))
-	return NULL;
+#if defined(HAVE_MEMFD_CREATE) && defined(PATH_DEV_FD)
+    if (isset(MEMORYSUBST) &&
+	(fd = movefd(memfd_create("zsh-subst", 0))) != -1) {
+	/* The shell keeps the anonymous file open and passes on its *
+	 * path under /dev/fd; like the pipes of <(...) it is closed *
+	 * once the command using it has been started or has run.   */
+	nam = ncalloc(strlen(PATH_DEV_FD) + 6);
+	sprintf(nam, "%s/%d", PATH_DEV_FD, fd);
+	fdtable[fd] = 2;
+	memfd = 1;
+	child_block();
+    } else
+#endif
+    {
+	if (!(nam = gettempname()))
+	    return NULL;
 
-    nam = ztrdup(nam);
-    PERMALLOC {
-	if (!jobtab[thisjob].filelist)
-	    jobtab[thisjob].filelist = newlinklist();
-	addlinknode(jobtab[thisjob].filelist, nam);
-    } LASTALLOC;
-    child_block();
-    fd = open(nam, O_WRONLY | O_CREAT | O_EXCL, 0600); /* create the file */
+	nam = ztrdup(nam);
+	PERMALLOC {
+	    if (!jobtab[thisjob].filelist)
+		jobtab[thisjob].filelist = newlinklist();
+	    addlinknode(jobtab[thisjob].filelist, nam);
+	} LASTALLOC;
+	child_block();
+	fd = open(nam, O_WRONLY | O_CREAT | O_EXCL, 0600); /* create the file */
+    }
 
     if (fd < 0 || (cmdoutpid = pid = zfork()) == -1) {
 	/* fork or open error */
@@ -2444,9 +2665,14 @@ getoutputfile(char *cmd)
     } else if (pid) {
 	int os;
 
-	close(fd);
+	if (!memfd)
+	    close(fd);
 	os = jobtab[thisjob].stat;
 	waitforpid(pid);
+	/* Where the fd directory works like dup(), whoever opens nam *
+	 * shares our offset, which the command left at the end.      */
+	if (memfd)
+	    lseek(fd, (off_t)0, SEEK_SET);
 	cmdoutval = 0;
 	jobtab[thisjob].stat = os;
 	return nam;
@@ -2457,6 +2683,7 @@ getoutputfile(char *cmd)
     opts[MONITOR] = 0;
     entersubsh(Z_SYNC, 1, 0);
     execlist(list, 0, 1);
+    fflush(stdout);
     close(1);
     _exit(lastval);
     zerr("exit returned in child!!", NULL, 0);
@@ -2545,6 +2772,7 @@ getproc(char *cmd)
 #endif
     execlist(list, 0, 1);
     zclose(out);
+    fflush(stdout);
     _exit(lastval);
     return NULL;
 #endif   /* HAVE_FIFOS and PATH_DEV_FD not defined */
@@ -2570,6 +2798,7 @@ getpipe(char *cmd)
     redup(pipes[out], out);
     closem(0);	/* this closes pipes[!out] as well */
     execlist(list, 0, 1);
+    fflush(stdout);
     _exit(lastval);
     return 0;
 }
@@ -2722,17 +2951,17 @@ execshfunc(Cmd cmd, Shfunc shf)
 	    } LASTALLOC;
 
 	    /* Execute the function definition, we just retrived */
-	    doshfunc(shf->funcdef, cmd->args, shf->flags, 0);
+	    doshfunc(nam, shf->funcdef, cmd->args, shf->flags, 0);
 
 	    /* See if this file defined the autoloaded function *
 	     * by name.  If so, we execute it again.            */
 	    if ((shf = (Shfunc) shfunctab->getnode(shfunctab, nam))
 		&& shf->funcdef && shf->funcdef != funcdef)
-		doshfunc(shf->funcdef, cmd->args, shf->flags, 0);
+		doshfunc(nam, shf->funcdef, cmd->args, shf->flags, 0);
 	}
     } else
 	/* Normal shell function execution */
-	doshfunc(shf->funcdef, cmd->args, shf->flags, 0);
+	doshfunc(nam, shf->funcdef, cmd->args, shf->flags, 0);
     if (!list_pipe)
 	deletefilelist(last_file_list);
 
@@ -2743,14 +2972,15 @@ execshfunc(Cmd cmd, Shfunc shf)
 
 /**/
 void
-doshfunc(List list, LinkList doshargs, int flags, int noreturnval)
+doshfunc(char *name, List list, LinkList doshargs, int flags, int noreturnval)
 /* If noreturnval is nonzero, then reset the current return *
  * value (lastval) to its value before the shell function   *
- * was executed.                                            */
+ * was executed.  name is only used for profiling.          */
 {
     Param pm;
     char **tab, **x, *oargv0 = NULL;
     int xexittr, newexittr, oldzoptind, oldlastval;
+    int prof = profiling && list;
     LinkList olist;
     char *s, *ou;
     void *xexitfn, *newexitfn;
@@ -2807,7 +3037,11 @@ doshfunc(List list, LinkList doshargs, int flags, int noreturnval)
 	locallevel++;
 	ou = underscore;
 	underscore = ztrdup(underscore);
+	if (prof)
+	    profenter(name);
 	execlist(dupstruct(list), 1, 0);
+	if (prof)
+	    profleave();
 	zsfree(underscore);
 	underscore = ou;
 	locallevel--;
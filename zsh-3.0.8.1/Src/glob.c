@@ -103,6 +103,7 @@ struct comp {
     Comp left, right, next, exclude;
     char *str;
     int stat;
+    int ind;			/* position in chain, see matchchain() */
 };
 
 /* Type of Comp:  a closure with one or two #'s, the end of a *
@@ -120,6 +121,30 @@ struct comp {
 #define LASTP(c)	(c->stat & C_LAST)
 #define PATHADDP(c)	(c->stat & C_PATHADD)
 
+/* State for the memoized matching used by getmatch().  While       *
+ * matchmode is set, doesmatch() marks every (component, position)  *
+ * pair it tries in matchvis and gives up at once on a pair already *
+ * marked: without alternatives or negation a pair that failed once *
+ * fails again, so each is explored only once.  With MM_ENDS a      *
+ * match may end anywhere: the shortest and longest ends are        *
+ * recorded in matchlo and matchhi and the search goes on.          */
+#define MM_MEMO		1
+#define MM_ENDS		2
+
+static int matchmode;
+static char *matchbase;		/* string being matched                 */
+static int matchlen;		/* its length                           */
+static int matchncomp;		/* components in the pattern            */
+static unsigned char *matchvis;	/* bit map of pairs tried               */
+static int matchtop;		/* highest position marked in matchvis  */
+static int matchfirst;		/* smallest end accepted for a match    */
+static int matchlong;		/* looking for the longest match        */
+static int matchlo, matchhi;	/* shortest and longest ends found      */
+static int matchdone;		/* no better end can be found           */
+
+static int matchseen _((Comp c));
+static int matchend _((int off, int star));
+
 /* Main entry point to the globbing code for filename globbing. *
  * np points to a node in the list list which will be expanded  *
  * into a series of nodes.                                      */
@@ -1249,6 +1274,190 @@ get_match_ret(char *s, int b, int e, int fl)
     return r;
 }
 
+/* Number the components of a compiled pattern for the memoized   *
+ * search.  Returns the number of components, or 0 if the pattern *
+ * contains alternatives, groups, exclusions, negation or numeric *
+ * ranges, whose success depends on more than the component and   *
+ * the position in the string reached.                            */
+
+static int
+matchchain(Comp c)
+{
+    int n = 0;
+    char *p;
+
+    for (; c; c = c->next) {
+	if (c->left || c->right || c->exclude || TWOHASHP(c) || !c->str)
+	    return 0;
+	for (p = c->str; *p; p++)
+	    if (*p == Meta)
+		p++;
+	    else if (*p == Inbrack) {
+		while (p[1] && p[1] != Outbrack)
+		    p++;
+	    } else if (*p == Hat || *p == Inang)
+		return 0;
+	c->ind = n++;
+    }
+    return n;
+}
+
+/* Return the first character any match of c must start with, *
+ * or 0 if it is not a plain character.  MATCHSTART tests if a *
+ * match can start at S given that character.                 */
+
+#define MATCHSTART(S, C) (!(C) || STOUC(*(S)) == (C) || *(S) == Nularg)
+
+static int
+matchfirstch(Comp c)
+{
+    if (CLOSUREP(c) || !*c->str || itok(*c->str) || *c->str == Meta)
+	return 0;
+    return STOUC(*c->str);
+}
+
+/* Try the pattern c once from position b of matchbase, leaving  *
+ * the shortest and longest ends of a match in matchlo and       *
+ * matchhi; matchhi is -1 and matchlo is past the end of the     *
+ * string if there is none.  The pairs tried are cleared again   *
+ * afterwards, so the cost is that of the part of the string the *
+ * pattern actually looked at.                                   */
+
+static void
+matchpass(Comp c, int b)
+{
+    long lo, hi;
+
+    matchlo = matchlen + 1;
+    matchhi = -1;
+    matchdone = 0;
+    matchtop = b;
+    domatch(matchbase + b, c, 0);
+
+    lo = ((long)b * matchncomp) >> 3;
+    hi = ((long)(matchtop + 1) * matchncomp + 7) >> 3;
+    memset(matchvis + lo, 0, hi - lo);
+}
+
+/* Set up matchbase and friends for a search in s with the pattern *
+ * c; returns 0 if c is not suitable for the memoized search.      */
+
+static int
+matchsetup(char *s, Comp c)
+{
+    if (!(matchncomp = matchchain(c)))
+	return 0;
+    matchbase = s;
+    matchlen = strlen(s);
+    matchdone = 0;
+    matchvis = (unsigned char *)
+	zcalloc(((long)(matchlen + 1) * matchncomp + 7) >> 3);
+    return 1;
+}
+
+static void
+matchfinish(void)
+{
+    zfree(matchvis, ((long)(matchlen + 1) * matchncomp + 7) >> 3);
+    matchvis = NULL;
+    matchmode = 0;
+}
+
+/* The n == 1 cases of getmatch() below, in a single memoized pass *
+ * over the string for the anchored forms and in one pass per      *
+ * starting position for the (S) forms, instead of trying every    *
+ * pair of start and end.  Returns 0 if the pattern can't be used. */
+
+static int
+fastmatch(char **sp, Comp c, int fl)
+{
+    char *s = *sp;
+    int l, b, e, i, ch, best;
+
+    if (!matchsetup(s, c))
+	return 0;
+    l = matchlen;
+    ch = matchfirstch(c);
+    b = e = 0;
+    switch (fl & 7) {
+    case 0:
+    case 2:
+	/* Shortest or longest match at head of string. */
+	matchmode = MM_ENDS;
+	matchfirst = 0;
+	matchlong = fl & 2;
+	matchpass(c, 0);
+	if (matchlong)
+	    e = matchhi > 0 ? matchhi : 0;
+	else
+	    e = matchlo <= l ? matchlo : 0;
+	break;
+
+    case 1:
+	/* Smallest possible match at tail of string. */
+	matchmode = MM_MEMO;
+	for (b = l; b >= 0; b--) {
+	    if (MATCHSTART(s + b, ch) && domatch(s + b, c, 0))
+		break;
+	    if (b > 1 && s[b-2] == Meta)
+		b--;
+	}
+	e = b < 0 ? (b = 0) : l;
+	break;
+
+    case 3:
+	/* Largest possible match at tail of string. */
+	matchmode = MM_MEMO;
+	for (b = 0; b < l; b++) {
+	    if (MATCHSTART(s + b, ch) && domatch(s + b, c, 0))
+		break;
+	    if (s[b] == Meta)
+		b++;
+	}
+	e = b >= l ? (b = 0) : l;
+	break;
+
+    default:
+	/* Matching substrings:  the shortest (4, 5) or longest (6, 7) *
+	 * non-empty match, the first (4, 6) or last (5, 7) of those.  *
+	 * An empty match counts before (4, 5) or after (6, 7) them.   */
+	if (!(fl & 2) && domatch(s + l, c, 0)) {
+	    b = e = (fl & 1) ? l : 0;
+	    break;
+	}
+	matchmode = MM_ENDS;
+	matchlong = fl & 2;
+	best = matchlong ? 0 : l + 1;
+	b = -1;
+	for (i = 0; i < l; i += (s[i] == Meta) ? 2 : 1) {
+	    if (matchlong && (l - i < best || (l - i == best && !(fl & 1))))
+		break;
+	    if (!MATCHSTART(s + i, ch))
+		continue;
+	    matchfirst = i + ((s[i] == Meta) ? 2 : 1);
+	    matchpass(c, i);
+	    if (matchlong) {
+		if (matchhi >= matchfirst && (matchhi - i > best ||
+		    (matchhi - i == best && (fl & 1))))
+		    b = i, e = matchhi, best = e - b;
+	    } else if (matchlo <= l && (matchlo - i < best ||
+		       (matchlo - i == best && (fl & 1))))
+		b = i, e = matchlo, best = e - b;
+	}
+	if (b < 0) {
+	    matchmode = 0;
+	    if ((fl & 2) && domatch(s + l, c, 0))
+		b = e = (fl & 1) ? l : 0;
+	    else
+		b = e = 0;
+	}
+	break;
+    }
+    matchfinish();
+    *sp = get_match_ret(s, b, e, fl);
+    return 1;
+}
+
 /* It is called from paramsubst to get the match for ${foo#bar} etc.
  * Bits of fl determines the required action:
  *   bit 0: match the end instead of the beginning (% or %%)
@@ -1284,6 +1493,8 @@ getmatch(char **sp, char *pat, int fl, int n)
 	    return 0;
 	return 1;
     }
+    if (n == 1 && fastmatch(sp, c, fl))
+	return 1;
     switch (fl & 7) {
     case 0:
 	/* Smallest possible match at head of string:    *
@@ -1451,6 +1662,84 @@ getmatch(char **sp, char *pat, int fl, int n)
     return 1;
 }
 
+/* Do the ${foo/bar/baz} and ${foo//bar/baz} substitution:  the      *
+ * longest non-empty match of pat at the first place in *sp where    *
+ * there is one is replaced by repl and, if gbal is set, so is every *
+ * such match in the rest of the string.  Each starting position is  *
+ * tried once only, using a single memoized pass where the pattern   *
+ * allows it, so for the common patterns the whole job is linear.    *
+ * The result is returned in *sp; ncalloc is used to get memory.     */
+
+/**/
+int
+getmatchrepl(char **sp, char *pat, char *repl, int gbal)
+{
+    Comp c;
+    char *s = *sp, *r, sav;
+    int l, rl, i, e, ch = 0, fast, nm = 0, szm = 0, *m = NULL, done, ret;
+
+    c = parsereg(pat);
+    if (!c) {
+	zerr("bad pattern: %s", pat, 0);
+	return 1;
+    }
+    if ((fast = matchsetup(s, c))) {
+	matchmode = MM_ENDS;
+	matchlong = 1;
+	ch = matchfirstch(c);
+    }
+    l = strlen(s);
+    for (i = 0; i < l && !errflag; ) {
+	e = -1;
+	if (MATCHSTART(s + i, ch)) {
+	    if (fast) {
+		matchfirst = i + ((s[i] == Meta) ? 2 : 1);
+		matchpass(c, i);
+		e = matchhi;
+	    } else
+		for (e = l; e > i; e--) {
+		    if (s[e-1] == Meta)
+			continue;
+		    sav = s[e];
+		    s[e] = '\0';
+		    ret = domatch(s + i, c, 0);
+		    s[e] = sav;
+		    if (ret)
+			break;
+		}
+	}
+	if (e > i) {
+	    /* remember where the match is */
+	    if (nm == szm)
+		m = (int *)zrealloc(m, (szm = 2 * szm + 8) * 2 * sizeof(int));
+	    m[2 * nm] = i;
+	    m[2 * nm++ + 1] = i = e;
+	    if (!gbal)
+		break;
+	} else
+	    i += (s[i] == Meta) ? 2 : 1;
+    }
+    if (fast)
+	matchfinish();
+    if (!nm)
+	return 1;
+
+    rl = strlen(repl);
+    for (i = 0, e = l; i < nm; i++)
+	e += rl - (m[2 * i + 1] - m[2 * i]);
+    r = *sp = (char *)ncalloc(e + 1);
+    for (i = done = 0; i < nm; i++) {
+	memcpy(r, s + done, m[2 * i] - done);
+	r += m[2 * i] - done;
+	memcpy(r, repl, rl);
+	r += rl;
+	done = m[2 * i + 1];
+    }
+    strcpy(r, s + done);
+    zfree(m, szm * 2 * sizeof(int));
+    return 1;
+}
+
 /* Add a component to pathbuf: This keeps track of how    *
  * far we are into a file name, since each path component *
  * must be matched separately.                            */
@@ -1646,6 +1935,49 @@ excluded(Comp c, char *eptr)
     return ret;
 }
 
+/* Mark the pair of c and the current position as tried for the *
+ * memoized search; returns 1 if it already was.                 */
+
+static int
+matchseen(Comp c)
+{
+    int off = pptr - matchbase;
+    long bit = (long)off * matchncomp + c->ind;
+
+    if (matchvis[bit >> 3] & (1 << (bit & 7)))
+	return 1;
+    matchvis[bit >> 3] |= 1 << (bit & 7);
+    if (off > matchtop)
+	matchtop = off;
+    return 0;
+}
+
+/* Record that a match can end at off or, if star is set, anywhere *
+ * from off to the end of the string.  Returns 0 so that doesmatch *
+ * goes on to look for other ends.                                 */
+
+static int
+matchend(int off, int star)
+{
+    if (star) {
+	if (off < matchfirst)
+	    off = matchfirst;
+	if (off <= matchlen) {
+	    if (off < matchlo)
+		matchlo = off;
+	    matchhi = matchlen;
+	}
+    } else if (off >= matchfirst) {
+	if (off < matchlo)
+	    matchlo = off;
+	if (off > matchhi)
+	    matchhi = off;
+    }
+    if (matchlong ? matchhi == matchlen : matchlo == matchfirst)
+	matchdone = 1;
+    return 0;
+}
+
 /* see if current string in pptr matches c */
 
 /**/
@@ -1656,6 +1988,14 @@ doesmatch(Comp c)
     int done = 0;
 
   tailrec:
+    if (matchmode) {
+	/* No shorter match can be found from beyond matchlo. */
+	if (matchdone ||
+	    (matchmode == MM_ENDS && !matchlong && pptr - matchbase >= matchlo))
+	    return 0;
+	if (matchseen(c))
+	    return 0;
+    }
     if (ONEHASHP(c) || (done && TWOHASHP(c))) {
 	/* Do multiple matches like (pat)# and (pat)## */
 	char *saves = pptr;
@@ -1700,8 +2040,11 @@ doesmatch(Comp c)
 		pat = c->str;
 		goto tailrec;
 	    }
-	    if (!c->next)	/* no more patterns left */
+	    if (!c->next) {	/* no more patterns left */
+		if (matchmode == MM_ENDS && LASTP(c))
+		    return matchend(pptr - matchbase, 0);
 		return (!LASTP(c) || !*pptr);
+	    }
 	    c = c->next;
 	    done = 0;
 	    pat = c->str;
@@ -1711,6 +2054,8 @@ doesmatch(Comp c)
 	if (first && *pptr == '.' && *pat != '.')
 	    return 0;
 	if (*pat == Star) {	/* final * is not expanded to ?#; returns success */
+	    if (matchmode == MM_ENDS && LASTP(c))
+		return matchend(pptr - matchbase, 1);
 	    while (*pptr)
 		pptr++;
 	    return 1;
@@ -99,6 +99,10 @@ EXTERN int errflag;
  
 EXTERN int trapreturn;
  
+/* true if shell functions are being profiled, see zprof */
+ 
+EXTERN int profiling;
+ 
 EXTERN char *tokstr;
 EXTERN int tok, tokfd;
  
@@ -285,6 +289,14 @@ EXTERN HashTable vikeybindtab;
 /* hash table for named directories */
 
 EXTERN HashTable nameddirtab;
+
+/* hash table for strings parsed by execstring() and eval */
+
+EXTERN HashTable parsecachetab;
+ 
+/* hash table for directories read by completion */
+
+EXTERN HashTable dircachetab;
  
 /* default completion infos */
  
@@ -292,7 +304,8 @@ EXTERN struct compctl cc_compos, cc_default, cc_first, cc_dummy;
  
 /* the job table */
  
-EXTERN struct job jobtab[MAXJOB];
+EXTERN struct job *jobtab;
+EXTERN int jobtabsize;
  
 /* shell timings */
  
@@ -409,6 +422,14 @@ EXTERN int fdtable_size;
 
 EXTERN int max_zsh_fd;
 
+/* Output of builtins to stdout is only flushed after each command  *
+ * if fd 1 is a terminal; otherwise it stays in the buffer until fd *
+ * 1 is changed, or some other writer or reader could come between. *
+ * This is 1 + isatty(1), or 0 if fd 1 has changed since the last   *
+ * check.                                                           */
+
+EXTERN int ttystdout;
+
 /* input fd from the coprocess */
 
 EXTERN int coprocin;
@@ -768,6 +789,7 @@ struct zoption optns[OPT_SIZE] = {
     {"magicequalsubst", 	0,    0,    OPT_EMULATE},
     {"mailwarning", 		'U',  0,    0},
     {"markdirs", 		'8',  'X',  0},
+    {"memorysubst", 		0,    0,    0},
     {"menucomplete", 		'Y',  0,    0},
     {"monitor", 		'm',  'm',  OPT_SPECIAL},
     {"multios", 		0,    0,    OPT_EMULATE|OPT_ZSH},
@@ -79,6 +79,8 @@ addhashnode(HashTable ht, char *nam, void *nodeptr)
 
     hn = (HashNode) nodeptr;
     hn->nam = nam;
+    if (ht->sorted)
+	addsorted(ht, hn);
 
     hashval = ht->hash(hn->nam) % ht->hsize;
     hp = ht->nodes[hashval];
@@ -186,6 +188,8 @@ removehashnode(HashTable ht, char *nam)
     if (!strcmp(hp->nam, nam)) {
 	ht->nodes[hashval] = hp->next;
 	ht->ct--;
+	if (ht->sorted)
+	    removesorted(ht, hp);
 	return hp;
     }
 
@@ -196,6 +200,8 @@ removehashnode(HashTable ht, char *nam)
 	if (!strcmp(hp->nam, nam)) {
 	    hq->next = hp->next;
 	    ht->ct--;
+	    if (ht->sorted)
+		removesorted(ht, hp);
 	    return hp;
 	}
     }
@@ -394,11 +400,14 @@ scanmatchtable(HashTable ht, Comp com, int flags1, int flags2, ScanFunc scanfunc
 void
 expandhashtable(HashTable ht)
 {
-    struct hashnode **onodes, **ha, *hn, *hp;
+    struct hashnode **onodes, **ha, *hn, *hp, **sorted;
     int i, osize;
 
     osize = ht->hsize;
     onodes = ht->nodes;
+    /* the nodes don't change, so keep the sorted index out of it */
+    sorted = ht->sorted;
+    ht->sorted = NULL;
 
     ht->hsize = osize * 4;
     ht->nodes = (HashNode *) zcalloc(ht->hsize * sizeof(HashNode));
@@ -414,6 +423,7 @@ expandhashtable(HashTable ht)
 	}
     }
     zfree(onodes, osize * sizeof(HashNode));
+    ht->sorted = sorted;
 }
 
 /* Empty the hash table and resize it if necessary */
@@ -425,6 +435,8 @@ emptyhashtable(HashTable ht, int newsize)
     struct hashnode **ha, *hn, *hp;
     int i;
 
+    freesorted(ht);
+
     /* free all the hash nodes */
     ha = ht->nodes;
     for (i = 0; i < ht->hsize; i++, ha++) {
@@ -449,6 +461,137 @@ emptyhashtable(HashTable ht, int newsize)
     ht->ct = 0;
 }
 
+/* A hash table may also have an index of its nodes sorted by name, *
+ * so that those with names beginning with a given prefix can be    *
+ * found by a binary search, as completion wants.  It is made the   *
+ * first time it is needed, and then kept up to date when nodes are *
+ * added or removed.  After many such changes it is thrown away     *
+ * instead, since sorting it again is then cheaper.                 */
+
+/* Find the position of the name nam in the sorted index, *
+ * or the position where it would be inserted.            */
+
+static int
+sortedpos(HashTable ht, char *nam)
+{
+    int lo = 0, hi = ht->nsorted, mid;
+
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (strcmp(ht->sorted[mid]->nam, nam) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+static int
+hnstrcmp(const void *ap, const void *bp)
+{
+    return strcmp((*(HashNode *)ap)->nam, (*(HashNode *)bp)->nam);
+}
+
+/**/
+void
+freesorted(HashTable ht)
+{
+    if (ht->sorted) {
+	zfree(ht->sorted, ht->sortsz * sizeof(HashNode));
+	ht->sorted = NULL;
+    }
+}
+
+/* Tell the sorted index that node hn is about to be added to the *
+ * table, replacing any node of the same name.                    */
+
+/**/
+void
+addsorted(HashTable ht, HashNode hn)
+{
+    int pos;
+
+    if (++ht->sortchg > ht->nsorted / 16 + 16) {
+	freesorted(ht);
+	return;
+    }
+    pos = sortedpos(ht, hn->nam);
+    if (pos < ht->nsorted && !strcmp(ht->sorted[pos]->nam, hn->nam)) {
+	ht->sorted[pos] = hn;
+	return;
+    }
+    if (ht->nsorted == ht->sortsz) {
+	HashNode *ns = (HashNode *) zalloc(2 * ht->sortsz * sizeof(HashNode));
+
+	memcpy(ns, ht->sorted, ht->nsorted * sizeof(HashNode));
+	zfree(ht->sorted, ht->sortsz * sizeof(HashNode));
+	ht->sorted = ns;
+	ht->sortsz *= 2;
+    }
+    memmove(ht->sorted + pos + 1, ht->sorted + pos,
+	    (ht->nsorted - pos) * sizeof(HashNode));
+    ht->sorted[pos] = hn;
+    ht->nsorted++;
+}
+
+/* Tell the sorted index that node hn was removed from the table. */
+
+/**/
+void
+removesorted(HashTable ht, HashNode hn)
+{
+    int pos;
+
+    if (++ht->sortchg > ht->nsorted / 16 + 16) {
+	freesorted(ht);
+	return;
+    }
+    pos = sortedpos(ht, hn->nam);
+    if (pos < ht->nsorted && ht->sorted[pos] == hn) {
+	ht->nsorted--;
+	memmove(ht->sorted + pos, ht->sorted + pos + 1,
+		(ht->nsorted - pos) * sizeof(HashNode));
+    }
+}
+
+/* Return the nodes whose names begin with the first len characters *
+ * of pfx, in order of their names, and put their number in *np.    *
+ * The array returned is only valid until the table is changed.     */
+
+/**/
+HashNode *
+gethashprefix(HashTable ht, char *pfx, int len, int *np)
+{
+    int lo, hi, mid, i;
+    HashNode hn;
+
+    if (!ht->sorted) {
+	ht->sortsz = ht->ct + 16;
+	ht->sorted = (HashNode *) zalloc(ht->sortsz * sizeof(HashNode));
+	ht->nsorted = ht->sortchg = 0;
+	for (i = 0; i < ht->hsize; i++)
+	    for (hn = ht->nodes[i]; hn; hn = hn->next)
+		ht->sorted[ht->nsorted++] = hn;
+	qsort((void *) ht->sorted, ht->nsorted, sizeof(HashNode), hnstrcmp);
+    }
+    for (lo = 0, hi = ht->nsorted; lo < hi; ) {
+	mid = (lo + hi) / 2;
+	if (strncmp(ht->sorted[mid]->nam, pfx, len) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    for (i = lo, hi = ht->nsorted; i < hi; ) {
+	mid = (i + hi) / 2;
+	if (strncmp(ht->sorted[mid]->nam, pfx, len) <= 0)
+	    i = mid + 1;
+	else
+	    hi = mid;
+    }
+    *np = hi - lo;
+    return ht->sorted + lo;
+}
+
 /* Print info about hash table */
 
 #ifdef ZSH_HASH_DEBUG
@@ -1198,6 +1341,95 @@ fillnameddirtable(HashTable ht)
     return;
 }
 
+/* The named directories are also chained in a second table hashed *
+ * on the directory instead of the name.  This lets finddir() look  *
+ * up each leading part of a path in turn, rather than comparing    *
+ * the path with every named directory.                             */
+
+static Nameddir *nddirs;
+static int nddirsz, nddirct;
+
+/* Take nd out of the directory chains, if it is there. */
+
+static void
+nddirunlink(Nameddir nd)
+{
+    Nameddir *ndp;
+
+    if (!nddirct)
+	return;
+    for (ndp = nddirs + hasher(nd->dir) % nddirsz; *ndp;
+	 ndp = &(*ndp)->dirnext)
+	if (*ndp == nd) {
+	    *ndp = nd->dirnext;
+	    nd->dirnext = NULL;
+	    nddirct--;
+	    return;
+	}
+}
+
+static void
+nddirlink(Nameddir nd)
+{
+    Nameddir *ndp;
+
+    if (!nddirs)
+	nddirs = (Nameddir *) zcalloc((nddirsz = INITIAL_NAMEDDIR) *
+				      sizeof(Nameddir));
+    else if (nddirct == nddirsz * 2) {
+	/* grow the table by 4 like expandhashtable() */
+	Nameddir *onddirs = nddirs, n, next;
+	int i, osize = nddirsz;
+
+	nddirs = (Nameddir *) zcalloc((nddirsz *= 4) * sizeof(Nameddir));
+	for (i = 0; i < osize; i++)
+	    for (n = onddirs[i]; n; n = next) {
+		next = n->dirnext;
+		ndp = nddirs + hasher(n->dir) % nddirsz;
+		n->dirnext = *ndp;
+		*ndp = n;
+	    }
+	zfree(onddirs, osize * sizeof(Nameddir));
+    }
+    ndp = nddirs + hasher(nd->dir) % nddirsz;
+    nd->dirnext = *ndp;
+    *ndp = nd;
+    nddirct++;
+}
+
+/* Find the named directory which shortens the path s the most, *
+ * and by more than diff characters.  Its directory must be the *
+ * whole of s or be followed in s by a `/'.                     */
+
+/**/
+Nameddir
+findnameddir(char *s, int diff)
+{
+    Nameddir nd, best = NULL;
+    unsigned hashval = 0;
+    char *t;
+    int len;
+
+    if (!nddirct)
+	return NULL;
+    for (t = s;; t++) {
+	if (!*t || *t == '/') {
+	    len = t - s;
+	    for (nd = nddirs[hashval % nddirsz]; nd; nd = nd->dirnext)
+		if (nd->diff > diff && !strncmp(nd->dir, s, len) &&
+		    !nd->dir[len]) {
+		    best = nd;
+		    diff = nd->diff;
+		}
+	    if (!*t)
+		break;
+	}
+	/* the same as hasher() does */
+	hashval += (hashval << 5) + *(unsigned char *)t;
+    }
+    return best;
+}
+
 /* Add an entry to the named directory hash *
  * table, clearing the finddir() cache and  *
  * initialising the `diff' member.          */
@@ -1210,6 +1442,9 @@ addnameddirnode(HashTable ht, char *nam, void *nodeptr)
 
     nd->diff = strlen(nd->dir) - strlen(nam);
     finddir(NULL);		/* clear the finddir cache */
+    /* expandhashtable() adds nodes which are already there */
+    nddirunlink(nd);
+    nddirlink(nd);
     addhashnode(ht, nam, nodeptr);
 }
 
@@ -1222,8 +1457,10 @@ removenameddirnode(HashTable ht, char *nam)
 {
     HashNode hn = removehashnode(ht, nam);
 
-    if(hn)
+    if(hn) {
+	nddirunlink((Nameddir) hn);
 	finddir(NULL);		/* clear the finddir cache */
+    }
     return hn;
 }
 
@@ -1235,6 +1472,8 @@ freenameddirnode(HashNode hn)
 {
     Nameddir nd = (Nameddir) hn;
  
+    /* a node replaced by addhashnode() is freed without being removed */
+    nddirunlink(nd);
     zsfree(nd->nam);
     zsfree(nd->dir);
     zfree(nd, sizeof(struct nameddir));
@@ -1414,3 +1653,452 @@ emptyvikeybindtable(HashTable ht)
 {
     emptyhashtable(ht, INITIAL_VIKEYBINDTAB);
 }
+
+/*****************************************/
+/* Parse Cache Hash Table Functions      */
+/*****************************************/
+
+/* Strings run through execstring() or eval are usually the same few *
+ * over and over, so the trees parsed from them are kept here.  The  *
+ * cache is bounded by the number of entries and by the total length *
+ * of their source text; the least recently used entries go first.  */
+
+/* size of the parse cache hash table, never expanded */
+#define INITIAL_PARSECACHE 37
+
+#define PARSECACHE_MAX     64		/* number of entries        */
+#define PARSECACHE_BYTES   65536	/* total length of the text */
+#define PARSECACHE_LONGEST 8192		/* longest text cached      */
+
+static Parsecache pcoldest, pcnewest;
+static int pcbytes;
+static long pchits, pcmisses, pcevicted, pcflushed;
+
+/**/
+void
+createparsecachetable(void)
+{
+    parsecachetab = newhashtable(INITIAL_PARSECACHE);
+
+    parsecachetab->hash        = hasher;
+    parsecachetab->emptytable  = emptyparsecachetable;
+    parsecachetab->filltable   = NULL;
+    parsecachetab->addnode     = addhashnode;
+    parsecachetab->getnode     = gethashnode2;
+    parsecachetab->getnode2    = gethashnode2;
+    parsecachetab->removenode  = removeparsecachenode;
+    parsecachetab->disablenode = NULL;
+    parsecachetab->enablenode  = NULL;
+    parsecachetab->freenode    = freeparsecachenode;
+    parsecachetab->printnode   = NULL;
+#ifdef ZSH_HASH_DEBUG
+    parsecachetab->printinfo   = printparsecacheinfo;
+    parsecachetab->tablename   = ztrdup("parsecachetab");
+#endif
+}
+
+/* Empty the parse cache.  This is needed whenever something *
+ * the parser depends on changes, i.e. aliases and reserved  *
+ * words.                                                    */
+
+/**/
+void
+emptyparsecachetable(HashTable ht)
+{
+    if (ht->ct)
+	pcflushed++;
+    emptyhashtable(ht, INITIAL_PARSECACHE);
+    pcoldest = pcnewest = NULL;
+    pcbytes = 0;
+}
+
+/* Remove an entry from the parse cache and from the list *
+ * of entries in order of use.                            */
+
+/**/
+HashNode
+removeparsecachenode(HashTable ht, char *nam)
+{
+    Parsecache pc = (Parsecache) removehashnode(ht, nam);
+
+    if (pc) {
+	if (pc->older)
+	    pc->older->newer = pc->newer;
+	else
+	    pcoldest = pc->newer;
+	if (pc->newer)
+	    pc->newer->older = pc->older;
+	else
+	    pcnewest = pc->older;
+	pcbytes -= strlen(pc->nam);
+    }
+    return (HashNode) pc;
+}
+
+/**/
+void
+freeparsecachenode(HashNode hn)
+{
+    Parsecache pc = (Parsecache) hn;
+
+    zsfree(pc->nam);
+    freestruct(pc->list);
+    zfree(pc->opts, OPT_SIZE);
+    zfree(pc, sizeof(struct parsecache));
+}
+
+/* Return a copy of the tree cached for s, or NULL if there is none *
+ * or it was parsed with different options in effect.  The copy is *
+ * made with the current allocation, like the one of a function     *
+ * definition before it is run.                                     */
+
+/**/
+List
+getparsecache(char *s)
+{
+    Parsecache pc;
+
+    pc = (Parsecache) parsecachetab->getnode(parsecachetab, s);
+    if (!pc || memcmp(pc->opts, opts, OPT_SIZE)) {
+	pcmisses++;
+	return NULL;
+    }
+    pchits++;
+    if (pc != pcnewest) {
+	/* move it to the most recently used end of the list */
+	if (pc->older)
+	    pc->older->newer = pc->newer;
+	else
+	    pcoldest = pc->newer;
+	pc->newer->older = pc->older;
+	pc->older = pcnewest;
+	pc->newer = NULL;
+	pcnewest = pcnewest->newer = pc;
+    }
+    return (List) dupstruct(pc->list);
+}
+
+/* Add the tree l parsed from s to the parse cache, making *
+ * room for it if necessary.                               */
+
+/**/
+void
+addparsecache(char *s, List l)
+{
+    Parsecache pc;
+    int len = strlen(s);
+
+    if (len > PARSECACHE_LONGEST)
+	return;
+    if ((pc = (Parsecache) parsecachetab->removenode(parsecachetab, s)))
+	parsecachetab->freenode((HashNode) pc);
+    while (pcoldest && (parsecachetab->ct >= PARSECACHE_MAX ||
+			pcbytes + len > PARSECACHE_BYTES)) {
+	pcevicted++;
+	parsecachetab->freenode(parsecachetab->removenode(parsecachetab,
+							  pcoldest->nam));
+    }
+
+    pc = (Parsecache) zcalloc(sizeof *pc);
+    PERMALLOC {
+	pc->list = (List) dupstruct(l);
+    } LASTALLOC;
+    pc->opts = (char *) zalloc(OPT_SIZE);
+    memcpy(pc->opts, opts, OPT_SIZE);
+    if ((pc->older = pcnewest))
+	pcnewest->newer = pc;
+    else
+	pcoldest = pc;
+    pcnewest = pc;
+    pcbytes += len;
+    parsecachetab->addnode(parsecachetab, ztrdup(s), pc);
+}
+
+#ifdef ZSH_HASH_DEBUG
+/**/
+void
+printparsecacheinfo(HashTable ht)
+{
+    printhashtabinfo(ht);
+    printf("\nbytes of source text cached                   : %4d\n", pcbytes);
+    printf("limits (entries / bytes / longest text)       : %d / %d / %d\n",
+	   PARSECACHE_MAX, PARSECACHE_BYTES, PARSECACHE_LONGEST);
+    printf("hits / misses                                 : %ld / %ld\n",
+	   pchits, pcmisses);
+    printf("entries evicted / times flushed               : %ld / %ld\n",
+	   pcevicted, pcflushed);
+}
+#endif
+
+/*****************************************/
+/* Directory Cache Hash Table Functions  */
+/*****************************************/
+
+/* File name completion reads the same directories again and again, *
+ * so their contents are kept here, together with the files known   *
+ * to be directories.  An entry is used only if the directory still *
+ * has the device, inode and modification time it had when it was  *
+ * read.  Other types (and directories reached through a symbolic   *
+ * link) can change without touching the directory, so they are     *
+ * looked up afresh each time.  `hash -r' (or `rehash') empties the *
+ * cache.  The cache is bounded by the number of directories and    *
+ * the memory used for them; the least recently used entries go     *
+ * first.                                                           */
+
+/* size of the directory cache hash table, never expanded */
+#define INITIAL_DIRCACHE 17
+
+#define DIRCACHE_MAX   32		/* number of directories  */
+#define DIRCACHE_BYTES 8388608		/* total memory for names */
+
+static Dircache dcoldest, dcnewest;
+static long dcbytes;
+static long dchits, dcmisses, dcstale, dcevicted, dcflushed;
+
+/**/
+void
+createdircachetable(void)
+{
+    dircachetab = newhashtable(INITIAL_DIRCACHE);
+
+    dircachetab->hash        = hasher;
+    dircachetab->emptytable  = emptydircachetable;
+    dircachetab->filltable   = NULL;
+    dircachetab->addnode     = addhashnode;
+    dircachetab->getnode     = gethashnode2;
+    dircachetab->getnode2    = gethashnode2;
+    dircachetab->removenode  = removedircachenode;
+    dircachetab->disablenode = NULL;
+    dircachetab->enablenode  = NULL;
+    dircachetab->freenode    = freedircachenode;
+    dircachetab->printnode   = NULL;
+#ifdef ZSH_HASH_DEBUG
+    dircachetab->printinfo   = printdircacheinfo;
+    dircachetab->tablename   = ztrdup("dircachetab");
+#endif
+}
+
+/**/
+void
+emptydircachetable(HashTable ht)
+{
+    if (ht->ct)
+	dcflushed++;
+    emptyhashtable(ht, INITIAL_DIRCACHE);
+    dcoldest = dcnewest = NULL;
+    dcbytes = 0;
+}
+
+/* Remove an entry from the directory cache and from the *
+ * list of entries in order of use.                      */
+
+/**/
+HashNode
+removedircachenode(HashTable ht, char *nam)
+{
+    Dircache dc = (Dircache) removehashnode(ht, nam);
+
+    if (dc) {
+	if (dc->older)
+	    dc->older->newer = dc->newer;
+	else
+	    dcoldest = dc->newer;
+	if (dc->newer)
+	    dc->newer->older = dc->older;
+	else
+	    dcnewest = dc->older;
+	dcbytes -= dc->bytes;
+    }
+    return (HashNode) dc;
+}
+
+/**/
+void
+freedircachenode(HashNode hn)
+{
+    Dircache dc = (Dircache) hn;
+
+    zsfree(dc->nam);
+    if (dc->nents) {
+	zfree(dc->names, dc->nents * sizeof(char *));
+	zfree(dc->types, dc->nents);
+    }
+    zfree(dc->buf, dc->bufsz);
+    zfree(dc, sizeof(struct dircache));
+}
+
+/* Read the directory path (whose status is in st) into a new *
+ * cache entry.  The names are stored one after another in a  *
+ * single buffer, the way zreaddir() returns them.  If abortf *
+ * is given and returns non-zero between two entries, reading *
+ * stops and nothing is cached.                               */
+
+static Dircache
+readdircache(char *path, struct stat *st, int (*abortf) _((void)))
+{
+    Dircache dc;
+    DIR *d;
+    char *n, *b, *buf;
+    int i, l, len = 0, sz = 4096, ct = 0;
+
+    if (!(d = opendir(unmeta(path))))
+	return NULL;
+    buf = (char *) zalloc(sz);
+    while ((n = zreaddir(d))) {
+	if (abortf && abortf()) {
+	    closedir(d);
+	    zfree(buf, sz);
+	    return NULL;
+	}
+	/* Ignore `.' and `..'. */
+	if (n[0] == '.' && (n[1] == '\0' || (n[1] == '.' && n[2] == '\0')))
+	    continue;
+	l = strlen(n) + 1;
+	if (len + l > sz) {
+	    while (len + l > sz)
+		sz *= 2;
+	    buf = (char *) zrealloc(buf, sz);
+	}
+	memcpy(buf + len, n, l);
+	len += l;
+	ct++;
+    }
+    closedir(d);
+
+    dc = (Dircache) zcalloc(sizeof *dc);
+    dc->dev = st->st_dev;
+    dc->ino = st->st_ino;
+    dc->mtime = st->st_mtime;
+    dc->rtime = time(NULL);
+    dc->buf = buf;
+    dc->bufsz = sz;
+    if ((dc->nents = ct)) {
+	dc->names = (char **) zalloc(ct * sizeof(char *));
+	for (b = buf, i = 0; i < ct; i++, b += strlen(b) + 1)
+	    dc->names[i] = b;
+	dc->types = (char *) zcalloc(ct);
+    }
+    dc->bytes = sz + ct * (sizeof(char *) + 1);
+    return dc;
+}
+
+/* Return the cache entry for the directory path, reading the *
+ * directory if it is not cached or has changed since.  The   *
+ * entry stays valid until the next call.  NULL is returned   *
+ * if the directory can't be read, or if abortf (if given)    *
+ * asked to stop while it was read.                           */
+
+/**/
+Dircache
+getdircache(char *path, int (*abortf) _((void)))
+{
+    Dircache dc;
+    struct stat st;
+
+    if (!*path)
+	path = ".";
+    /* An entry bigger than the whole cache is kept only until now. */
+    while (dcoldest && dcbytes > DIRCACHE_BYTES) {
+	dcevicted++;
+	dircachetab->freenode(dircachetab->removenode(dircachetab,
+						      dcoldest->nam));
+    }
+    if (stat(unmeta(path), &st) < 0)
+	return NULL;
+
+    dc = (Dircache) dircachetab->getnode(dircachetab, path);
+    /* If the directory was modified in the second it was read in, *
+     * we can't tell later changes from that by the time stamp.    */
+    if (dc && (dc->dev != st.st_dev || dc->ino != st.st_ino ||
+	       dc->mtime != st.st_mtime || dc->mtime >= dc->rtime)) {
+	dcstale++;
+	dircachetab->freenode(dircachetab->removenode(dircachetab, path));
+	dc = NULL;
+    }
+    if (dc) {
+	dchits++;
+	if (dc != dcnewest) {
+	    /* move it to the most recently used end of the list */
+	    if (dc->older)
+		dc->older->newer = dc->newer;
+	    else
+		dcoldest = dc->newer;
+	    dc->newer->older = dc->older;
+	    dc->older = dcnewest;
+	    dc->newer = NULL;
+	    dcnewest = dcnewest->newer = dc;
+	}
+    } else {
+	dcmisses++;
+	if (!(dc = readdircache(path, &st, abortf)))
+	    return NULL;
+	while (dcoldest && (dircachetab->ct >= DIRCACHE_MAX ||
+			    dcbytes + dc->bytes > DIRCACHE_BYTES)) {
+	    dcevicted++;
+	    dircachetab->freenode(dircachetab->removenode(dircachetab,
+							  dcoldest->nam));
+	}
+	if ((dc->older = dcnewest))
+	    dcnewest->newer = dc;
+	else
+	    dcoldest = dc;
+	dcnewest = dc;
+	dcbytes += dc->bytes;
+	dircachetab->addnode(dircachetab, ztrdup(path), dc);
+    }
+    return dc;
+}
+
+/* Get the type of the i'th file in a cached directory.  Only a   *
+ * directory that is not a symbolic link is remembered: it can't   *
+ * become anything else without the directory being modified.     *
+ * The permissions of a file or the target of a link can, so those *
+ * are looked at again every time.                                 */
+
+/**/
+int
+dircachetype(Dircache dc, int i)
+{
+    struct stat buf;
+    char p[PATH_MAX], *up;
+    int pl, link;
+
+    if (dc->types[i] != DCT_UNKNOWN)
+	return dc->types[i];
+    strcpy(p, dc->nam);
+    pl = strlen(p);
+    if (pl && p[pl - 1] != '/')
+	p[pl++] = '/';
+    if (pl + strlen(dc->names[i]) >= PATH_MAX)
+	return DCT_NOSTAT;
+    strcpy(p + pl, dc->names[i]);
+    up = unmeta(p);
+    if (lstat(up, &buf) < 0 ||
+	((link = S_ISLNK(buf.st_mode)) && stat(up, &buf) < 0))
+	return DCT_NOSTAT;
+    if (S_ISDIR(buf.st_mode)) {
+	if (!link)
+	    dc->types[i] = DCT_DIR;
+	return DCT_DIR;
+    }
+    if ((buf.st_mode & (S_IFMT | S_IEXEC)) == (S_IFREG | S_IEXEC))
+	return DCT_EXEC;
+    return DCT_OTHER;
+}
+
+#ifdef ZSH_HASH_DEBUG
+/**/
+void
+printdircacheinfo(HashTable ht)
+{
+    printhashtabinfo(ht);
+    printf("\nbytes used for cached directories             : %4ld\n",
+	   dcbytes);
+    printf("limits (directories / bytes)                  : %d / %d\n",
+	   DIRCACHE_MAX, DIRCACHE_BYTES);
+    printf("hits / misses / out of date                   : %ld / %ld / %ld\n",
+	   dchits, dcmisses, dcstale);
+    printf("entries evicted / times flushed               : %ld / %ld\n",
+	   dcevicted, dcflushed);
+}
+#endif
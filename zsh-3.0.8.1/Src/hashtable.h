@@ -311,7 +311,7 @@ struct builtin builtins[] =
     {NULL, "pushln", BINF_PRINTOPTS, bin_print, 0, -1, BIN_PRINT, NULL, "-nz"},
     {NULL, "pwd", 0, bin_pwd, 0, 0, 0, "r", NULL},
     {NULL, "r", BINF_R, bin_fc, 0, -1, BIN_FC, "nrl", NULL},
-    {NULL, "read", 0, bin_read, 0, -1, 0, "rzu0123456789pkqecnAlE", NULL},
+    {NULL, "read", 0, bin_read, 0, -1, 0, "rzu0123456789pkqecnAlEL", NULL},
     {NULL, "readonly", BINF_TYPEOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL, bin_typeset, 0, -1, 0, "LRUZfiltux", "r"},
     {NULL, "rehash", 0, bin_hash, 0, 0, 0, "df", "r"},
     {NULL, "return", BINF_PSPECIAL, bin_break, 0, 1, BIN_RETURN, NULL, NULL},
@@ -337,10 +337,11 @@ struct builtin builtins[] =
     {NULL, "unset", BINF_PSPECIAL, bin_unset, 1, -1, 0, "fm", NULL},
     {NULL, "unsetopt", 0, bin_setopt, 0, -1, BIN_UNSETOPT, NULL, NULL},
     {NULL, "vared", 0, bin_vared, 1, 7, 0, NULL, NULL},
-    {NULL, "wait", 0, bin_fg, 0, -1, BIN_WAIT, NULL, NULL},
+    {NULL, "wait", 0, bin_fg, 0, -1, BIN_WAIT, "n", NULL},
     {NULL, "whence", 0, bin_whence, 0, -1, 0, "acmpvf", NULL},
     {NULL, "where", 0, bin_whence, 0, -1, 0, "pm", "ca"},
     {NULL, "which", 0, bin_whence, 0, -1, 0, "amp", "c"},
+    {NULL, "zprof", 0, bin_zprof, 0, 0, 0, "acdefnt", NULL},
     {NULL, NULL}
 };
 #else
@@ -75,12 +75,49 @@ hwaddc(int c)
 	if (hptr - chline >= hlinesz) {
 	    int oldsiz = hlinesz;
 
-	    chline = realloc(chline, hlinesz = oldsiz + 16);
+	    chline = realloc(chline, hlinesz = oldsiz * 2);
 	    hptr = chline + oldsiz;
 	}
     }
 }
 
+/* The lexer may read a run of ordinary characters in one go rather *
+ * than through hgetc().  hgetrun() returns the characters left in  *
+ * the current input buffer, or NULL if they must be read one at a  *
+ * time.  hskiprun() then consumes n of them and adds them to the   *
+ * history line as a whole.  The characters consumed must not need  *
+ * history expansion, so may not include bangchar or backslashes    *
+ * unless history is stopped, nor newlines or tokens.               */
+
+/**/
+char *
+hgetrun(int *np)
+{
+    if (lexstop || errflag || expanding || (isfirstch && !stophist))
+	return NULL;
+    return inpeek(np);
+}
+
+/**/
+void
+hskiprun(char *s, int n)
+{
+    inskip(n);
+    qbang = 0;
+    if (chline) {
+	if (hptr - chline + n >= hlinesz) {
+	    int oldsiz = hptr - chline;
+
+	    while (oldsiz + n >= hlinesz)
+		hlinesz *= 2;
+	    chline = realloc(chline, hlinesz);
+	    hptr = chline + oldsiz;
+	}
+	memcpy(hptr, s, n);
+	hptr += n;
+    }
+}
+
 /* This function adds a character to the zle input line. It is used when *
  * zsh expands history (see doexpandhist() in zle_tricky.c). It also     *
  * calculates the new cursor position after the expansion. It is called  *
@@ -1093,12 +1130,16 @@ makecapitals(char **junkptr)
     return 1;
 }
 
+/* Replace the first occurrence of in in *strptr by out or, with gbal, *
+ * all of them.  The occurrences are found first, so that the new     *
+ * string can be built in a single allocation.                       */
+
 /**/
 void
 subst(char **strptr, char *in, char *out, int gbal)
 {
-    char *str = *strptr, *instr = *strptr, *substcut, *sptr, *oldstr;
-    int off, inlen, outlen;
+    char *str = *strptr, *instr = *strptr, *substcut, *sptr, *ptr;
+    int inlen, outlen, n;
 
     if (!*in)
 	in = str, gbal = 0;
@@ -1108,15 +1149,18 @@ subst(char **strptr, char *in, char *out, int gbal)
     sptr = convamps(out, in, inlen);
     outlen = strlen(sptr);
 
-    do {
-	*substcut = '\0';
-	off = substcut - *strptr + outlen;
-	substcut += inlen;
-	*strptr = tricat(oldstr = *strptr, sptr, substcut);
-	if (oldstr != instr)
-	    zsfree(oldstr);
-	str = (char *)*strptr + off;
-    } while (gbal && (substcut = (char *)strstr(str, in)));
+    for (n = 1; gbal && (substcut = (char *)strstr(substcut + inlen, in));)
+	n++;
+    ptr = *strptr = (char *)zalloc(strlen(instr) + n * (outlen - inlen) + 1);
+    while (n--) {
+	substcut = (char *)strstr(str, in);
+	memcpy(ptr, str, substcut - str);
+	ptr += substcut - str;
+	memcpy(ptr, sptr, outlen);
+	ptr += outlen;
+	str = substcut + inlen;
+    }
+    strcpy(ptr, str);
 }
 
 /**/
@@ -149,13 +149,16 @@ loop(int toplevel, int justonce)
 		    if (he && he->text)
 			addlinknode(args, he->text);
 		} LASTALLOC;
-		doshfunc(prelist, args, 0, 1);
+		doshfunc("preexec", prelist, args, 0, 1);
 		freelinklist(args, (FreeFunc) NULL);
 		errflag = 0;
 	    }
 	    if (stopmsg)	/* unset 'you have stopped jobs' flag */
 		stopmsg--;
 	    execlist(list, 0, 0);
+	    /* Builtins' output stays buffered only within a command, so *
+	     * a signal from outside loses at most this command's output. */
+	    fflush(stdout);
 	    tok = toksav;
 	    if (toplevel)
 		noexitct = 0;
@@ -463,11 +466,16 @@ init_io(void)
 #endif
 }
 
+/* The line editor writes out each screen update with a single fflush(), *
+ * so the buffer for shout should hold a screenful of changes.           */
+
+#define SHOUTBUFSIZ 16384
+
 /**/
 void
 init_shout(void)
 {
-    static char shoutbuf[BUFSIZ];
+    static char shoutbuf[SHOUTBUFSIZ];
 #if defined(JOB_CONTROL) && defined(TIOCSETD) && defined(NTTYDISC)
     int ldisc = NTTYDISC;
 
@@ -477,7 +485,7 @@ init_shout(void)
     /* Associate terminal file descriptor with a FILE pointer */
     shout = fdopen(SHTTY, "w");
 #ifdef _IOFBF
-    setvbuf(shout, shoutbuf, _IOFBF, BUFSIZ);
+    setvbuf(shout, shoutbuf, _IOFBF, SHOUTBUFSIZ);
 #endif
   
     gettyinfo(&shttyinfo);	/* get tty state */
@@ -601,6 +609,9 @@ setupvals(void)
     cmdstack = (unsigned char *) zalloc(256);
     cmdsp = 0;
 
+    jobtab = (struct job *) zcalloc((jobtabsize = MAXJOBS_ALLOC) *
+				    sizeof(struct job));
+
     bangchar = '!';
     hashchar = '#';
     hatchar = '^';
@@ -706,6 +717,8 @@ setupvals(void)
     createbuiltintable();   /* create hash table for builtin commands  */
     createcompctltable();   /* create hash table for compctls          */
     createnameddirtable();  /* create hash table for named directories */
+    createparsecachetable(); /* create hash table for parsed strings   */
+    createdircachetable();  /* create hash table for completion dirs   */
     createparamtable();     /* create paramater hash table             */
 
 #ifdef TIOCGWINSZ
@@ -186,6 +186,29 @@ ingetc(void)
     }
 }
 
+/* Return the characters left in the current input buffer, and *
+ * their number in *np.  They may be consumed with inskip().     */
+
+/**/
+char *
+inpeek(int *np)
+{
+    *np = inbufleft;
+    return inbufptr;
+}
+
+/* Consume n characters returned by inpeek().  They must not include *
+ * newlines or tokens, which ingetc() has to look at one by one.     */
+
+/**/
+void
+inskip(int n)
+{
+    inbufptr += n;
+    inbufleft -= n;
+    inbufct -= n;
+}
+
 /* Read a line from the current command stream and store it as input */
 
 /**/
@@ -194,6 +217,8 @@ inputline(void)
 {
     unsigned char *ingetcline, *ingetcpmptl = NULL, *ingetcpmptr = NULL;
 
+    /* Let output left by builtins out before prompting or reading */
+    fflush(stdout);
     /* If reading code interactively, work out the prompts. */
     if (interact && isset(SHINSTDIN)) {
 	if (!isfirstln)
@@ -72,6 +72,32 @@ makerunning(Job jn)
 	makerunning(jobtab + jn->other);
 }
 
+/* The processes of all jobs are also chained in a table hashed on *
+ * their pids, so that the SIGCHLD handler can find the job a pid   *
+ * belongs to without going through the whole job table.            */
+
+#define PIDTABSIZE 251
+
+static Process pidtab[PIDTABSIZE];
+
+#define pidhash(pid) ((unsigned long) (pid) % PIDTABSIZE)
+
+/* Take the processes of job jn out of the pid table. */
+
+/**/
+void
+unhashprocs(Job jn)
+{
+    Process pn, *pp;
+
+    for (pn = jn->procs; pn; pn = pn->next)
+	for (pp = pidtab + pidhash(pn->pid); *pp; pp = &(*pp)->pidnext)
+	    if (*pp == pn) {
+		*pp = pn->pidnext;
+		break;
+	    }
+}
+
 /* Find process and job associated with pid.         *
  * Return 1 if search was successful, else return 0. */
 
@@ -80,30 +106,33 @@ int
 findproc(pid_t pid, Job *jptr, Process *pptr)
 {
     Process pn;
-    int i;
 
     /* initialize returned pointers to NULL */
     *jptr = NULL;
     *pptr = NULL;
-    for (i = 1; i < MAXJOB; i++) {
+    for (pn = pidtab[pidhash(pid)]; pn; pn = pn->pidnext) {
 	/* oldfaber: fix from Zsh 4.3.15 needed for Windows
 	 *           that recycles the pid very fast.
 	 * We are only interested in jobs with processes still
 	 * marked as live.  Careful in case there's an identical
 	 * process number in a job we haven't quite got around
-	 * to deleting.
+	 * to deleting.  A live one in the lowest numbered job
+	 * wins, else the one in the highest numbered job.
 	 */
-	if (jobtab[i].stat & STAT_DONE)
+	if (pn->pid != pid || (jobtab[pn->job].stat & STAT_DONE))
 	    continue;
-	for (pn = jobtab[i].procs; pn; pn = pn->next)
-	    if (pn->pid == pid) {
+	if (pn->status == SP_RUNNING) {
+	    if (!*pptr || (*pptr)->status != SP_RUNNING ||
+		pn->job < (*pptr)->job)
 		*pptr = pn;
-		*jptr = jobtab + i;
-		if (pn->status == SP_RUNNING) 
-		    return 1;
-	    }
+	} else if (!*pptr || ((*pptr)->status != SP_RUNNING &&
+			      pn->job > (*pptr)->job))
+	    *pptr = pn;
     }
-    return (*pptr && *jptr);
+    if (!*pptr)
+	return 0;
+    *jptr = jobtab + (*pptr)->job;
+    return 1;
 }
 
 /* Find the super-job of a sub-job. */
@@ -113,7 +142,7 @@ super_job(int sub)
 {
     int i;
 
-    for (i = 1; i < MAXJOB; i++)
+    for (i = 1; i < jobtabsize; i++)
 	if ((jobtab[i].stat & STAT_SUPERJOB) &&
 	    jobtab[i].other == sub &&
 	    jobtab[i].gleader)
@@ -184,24 +213,16 @@ handle_sub(int job, int fg)
     return 0;
 }
 
-/* Update status of process that we have just WAIT'ed for */
+/* Update status of process that we have just WAIT'ed for, *
+ * given the time it used and the time it was reaped.       */
 
 /**/
 void
-update_process(Process pn, int status)
+update_process(Process pn, int status, struct timeinfo *ti, struct timeval *endtime)
 {
-    struct timezone dummy_tz;
-    long childs, childu;
-
-    childs = shtms.tms_cstime;
-    childu = shtms.tms_cutime;
-    times(&shtms);                          /* get time-accounting info          */
-
     pn->status = status;                    /* save the status returned by WAIT  */
-    pn->ti.st  = shtms.tms_cstime - childs; /* compute process system space time */
-    pn->ti.ut  = shtms.tms_cutime - childu; /* compute process user space time   */
-
-    gettimeofday(&pn->endtime, &dummy_tz);  /* record time process exited        */
+    pn->ti = *ti;                           /* user and system time used         */
+    pn->endtime = *endtime;                 /* record time process exited        */
 }
 
 /* Update status of job, possibly printing it */
@@ -433,6 +454,8 @@ printjob(Job jn, int lng, int synch)
 
 	if (!synch)
 	    trashzle();
+	if (fout != stdout)
+	    fflush(stdout);
 	if (doputnl && !synch)
 	    putc('\n', fout);
 	for (pn = jn->procs; pn;) {
@@ -553,6 +576,7 @@ deletejob(Job jn)
 	adjustwinsize(0);
     }
 
+    unhashprocs(jn);
     for (pn = jn->procs; pn; pn = nx) {
 	nx = pn->next;
 	zfree(pn, sizeof(struct process));
@@ -583,14 +607,14 @@ setprevjob(void)
 #define STAT_is_STOPPED \
     ((jobtab[i].stat & (STAT_INUSE|STAT_STOPPED)) == (STAT_INUSE|STAT_STOPPED))
 
-    for (i = MAXJOB - 1; i; i--)
+    for (i = jobtabsize - 1; i; i--)
 	if (STAT_is_STOPPED && !STAT_is_SUBJOB &&
 	    i != curjob && i != thisjob) {
 	    prevjob = i;
 	    return;
 	}
 
-    for (i = MAXJOB - 1; i; i--)
+    for (i = jobtabsize - 1; i; i--)
 	if (STAT_is_INUSE && !STAT_is_SUBJOB &&
 	    i != curjob && i != thisjob) {
 	    prevjob = i;
@@ -615,6 +639,9 @@ addproc(pid_t pid, char *text)
 
     pn = (Process) zcalloc(sizeof *pn);
     pn->pid = pid;
+    pn->job = thisjob;
+    pn->pidnext = pidtab[pidhash(pid)];
+    pidtab[pidhash(pid)] = pn;
     if (text)
 	strcpy(pn->text, text);
     else
@@ -658,7 +685,7 @@ havefiles(void)
 {
     int i;
 
-    for (i = 1; i < MAXJOB; i++)
+    for (i = 1; i < jobtabsize; i++)
 	if (jobtab[i].stat && jobtab[i].filelist)
 	    return 1;
     return 0;
@@ -708,6 +735,8 @@ waitjob(int job, int sig)
 	       !(jn->stat & STAT_DONE) &&
 	       !(interact && (jn->stat & STAT_STOPPED))) {
 	    child_suspend(sig);
+	    /* a trap may have made new jobs and so moved the table */
+	    jn = jobtab + job;
 	    /* Commenting this out makes ^C-ing a job started by a function
 	       stop the whole function again.  But I guess it will stop
 	       something else from working properly, we have to find out
@@ -728,6 +757,54 @@ waitjob(int job, int sig)
     child_unblock();
 }
 
+/* Wait for the first of the njobs jobs in jobs, or of all the   *
+ * background jobs if jobs is NULL, to finish.  Returns its job   *
+ * number and puts its status in *statp, without removing it from *
+ * the table; returns -1 if none of them is running any more or   *
+ * if we were interrupted.                                        */
+
+/**/
+int
+waitanyjob(int *jobs, int njobs, int *statp)
+{
+    Process pn;
+    int i, j, running, found = -1, notify = opts[NOTIFY];
+
+    /* Done jobs must stay in the table until we have seen them, *
+     * so the SIGCHLD handler must not report and delete them.   */
+    opts[NOTIFY] = 0;
+    child_block();
+    while (!errflag) {
+	running = 0;
+	for (i = 0; i < (jobs ? njobs : jobtabsize); i++) {
+	    j = jobs ? jobs[i] : i;
+	    if (j < 1 || j >= jobtabsize || j == thisjob ||
+		!(jobtab[j].stat & STAT_INUSE) || !jobtab[j].procs ||
+		(jobtab[j].stat & STAT_NOPRINT))
+		continue;
+	    if (jobtab[j].stat & STAT_DONE) {
+		found = j;
+		break;
+	    }
+	    if (!(jobtab[j].stat & STAT_STOPPED))
+		running = 1;
+	}
+	if (found != -1 || !running)
+	    break;
+	child_suspend(SIGINT);
+	child_block();
+    }
+    child_unblock();
+    opts[NOTIFY] = notify;
+
+    if (found != -1) {
+	for (pn = jobtab[found].procs; pn->next; pn = pn->next);
+	*statp = WIFSIGNALED(pn->status) ?
+	    0200 | WTERMSIG(pn->status) : WEXITSTATUS(pn->status);
+    }
+    return found;
+}
+
 /* wait for running job to finish */
 
 /**/
@@ -746,14 +823,15 @@ clearjobtab(void)
 {
     int i;
 
-    for (i = 1; i < MAXJOB; i++) {
+    for (i = 1; i < jobtabsize; i++) {
 	if (jobtab[i].pwd)
 	    zsfree(jobtab[i].pwd);
 	if (jobtab[i].ty)
 	    zfree(jobtab[i].ty, sizeof(struct ttyinfo));
     }
 
-    memset(jobtab, 0, sizeof(jobtab)); /* zero out table */
+    memset(jobtab, 0, jobtabsize * sizeof(struct job)); /* zero out table */
+    memset(pidtab, 0, sizeof(pidtab));
 }
 
 /* Get a free entry in the job table and initialize it. */
@@ -764,18 +842,38 @@ initjob(void)
 {
     int i;
 
-    for (i = 1; i < MAXJOB; i++)
+    for (i = 1; i < jobtabsize; i++)
 	if (!jobtab[i].stat) {
 	    jobtab[i].stat = STAT_INUSE;
 	    jobtab[i].pwd = ztrdup(pwd);
 	    jobtab[i].gleader = 0;
 	    return i;
 	}
+    if (expandjobtab())
+	return initjob();
 
     zerr("job table full or recursion limit exceeded", NULL, 0);
     return -1;
 }
 
+/* Make room for more jobs in the job table.  This moves the table, *
+ * so pointers into it must be got again after a new job is made.   *
+ * Returns 0 if the table has reached its maximum size.             */
+
+/**/
+int
+expandjobtab(void)
+{
+    int newsize = jobtabsize + MAXJOBS_ALLOC;
+
+    if (newsize > MAX_MAXJOBS)
+	return 0;
+    jobtab = (struct job *) realloc(jobtab, newsize * sizeof(struct job));
+    memset(jobtab + jobtabsize, 0, MAXJOBS_ALLOC * sizeof(struct job));
+    jobtabsize = newsize;
+    return 1;
+}
+
 /* print pids for & */
 
 /**/
@@ -792,6 +890,7 @@ spawnjob(void)
 	} else if (prevjob == -1 || !(jobtab[prevjob].stat & STAT_STOPPED))
 	    prevjob = thisjob;
 	if (interact && jobbing && jobtab[thisjob].procs) {
+	    fflush(stdout);
 	    fprintf(stderr, "[%d]", thisjob);
 	    for (pn = jobtab[thisjob].procs; pn; pn = pn->next)
 		fprintf(stderr, " %ld", (long) pn->pid);
@@ -834,6 +933,62 @@ set_clktck(void)
 #endif
 }
 
+#ifdef WAIT_RUSAGE
+
+/* Fill in a timeinfo from what getrusage() or wait3() returned. */
+
+/**/
+void
+rusagetime(struct timeinfo *ti, struct rusage *ru)
+{
+    set_clktck();
+    ti->ut = (long) (ru->ru_utime.tv_sec * clktck +
+		     ru->ru_utime.tv_usec * (double) clktck / 1000000.0);
+    ti->st = (long) (ru->ru_stime.tv_sec * clktck +
+		     ru->ru_stime.tv_usec * (double) clktck / 1000000.0);
+    ti->maxrss = ru->ru_maxrss;
+    ti->majflt = ru->ru_majflt;
+    ti->minflt = ru->ru_minflt;
+    ti->nvcsw = ru->ru_nvcsw;
+    ti->nivcsw = ru->ru_nivcsw;
+    ti->inblock = ru->ru_inblock;
+    ti->oublock = ru->ru_oublock;
+}
+
+#endif
+
+/* Return the number of clock ticks per second, the unit of times(). */
+
+/**/
+long
+getclktck(void)
+{
+    set_clktck();
+    return clktck;
+}
+
+/* Add up the resources used by all the processes of a job. */
+
+static void
+jobtime(Job jn, struct timeinfo *ti)
+{
+    Process pn;
+
+    memset(ti, 0, sizeof(struct timeinfo));
+    for (pn = jn->procs; pn; pn = pn->next) {
+	ti->ut += pn->ti.ut;
+	ti->st += pn->ti.st;
+	if (pn->ti.maxrss > ti->maxrss)
+	    ti->maxrss = pn->ti.maxrss;
+	ti->majflt += pn->ti.majflt;
+	ti->minflt += pn->ti.minflt;
+	ti->nvcsw += pn->ti.nvcsw;
+	ti->nivcsw += pn->ti.nivcsw;
+	ti->inblock += pn->ti.inblock;
+	ti->oublock += pn->ti.oublock;
+    }
+}
+
 /* Check whether shell should report the amount of time consumed   *
  * by job.  This will be the case if we have preceded the command  *
  * with the keyword time, or if REPORTTIME is non-negative and the *
@@ -846,6 +1001,7 @@ should_report_time(Job j)
     Value v;
     char *s = "REPORTTIME";
     int reporttime;
+    struct timeinfo ti;
 
     /* if the time keyword was used */
     if (j->stat & STAT_TIMED)
@@ -859,7 +1015,8 @@ should_report_time(Job j)
 	return 0;
 
     set_clktck();
-    return ((j->procs->ti.ut + j->procs->ti.st) / clktck >= reporttime);
+    jobtime(j, &ti);
+    return ((ti.ut + ti.st) / clktck >= reporttime);
 }
 
 /**/
@@ -887,6 +1044,8 @@ printtime(struct timeval *real, struct timeinfo *ti, char *desc)
     double elapsed_time, user_time, system_time;
     int percent;
 
+    /* stdout may still hold output that came before the times */
+    fflush(stdout);
     if (!desc)
 	desc = "";
 
@@ -933,6 +1092,27 @@ printtime(struct timeval *real, struct timeinfo *ti, char *desc)
 	    case 'P':
 		fprintf(stderr, "%d%%", percent);
 		break;
+	    case 'M':
+		fprintf(stderr, "%ld", ti->maxrss);
+		break;
+	    case 'F':
+		fprintf(stderr, "%ld", ti->majflt);
+		break;
+	    case 'R':
+		fprintf(stderr, "%ld", ti->minflt);
+		break;
+	    case 'w':
+		fprintf(stderr, "%ld", ti->nvcsw);
+		break;
+	    case 'c':
+		fprintf(stderr, "%ld", ti->nivcsw);
+		break;
+	    case 'I':
+		fprintf(stderr, "%ld", ti->inblock);
+		break;
+	    case 'O':
+		fprintf(stderr, "%ld", ti->oublock);
+		break;
 	    case 'J':
 		fprintf(stderr, "%s", desc);
 		break;
@@ -961,6 +1141,21 @@ dumptime(Job jn)
 	return;
     for (pn = jn->procs; pn; pn = pn->next)
 	printtime(dtime(&dtimeval, &pn->bgtime, &pn->endtime), &pn->ti, pn->text);
+    if (jn->procs->next) {
+	/* and for a pipeline, the whole of it, from the start of *
+	 * the first process to the end of the last to finish     */
+	struct timeinfo ti;
+	struct timeval end;
+
+	jobtime(jn, &ti);
+	end = jn->procs->endtime;
+	for (pn = jn->procs->next; pn; pn = pn->next)
+	    if (pn->endtime.tv_sec > end.tv_sec ||
+		(pn->endtime.tv_sec == end.tv_sec &&
+		 pn->endtime.tv_usec > end.tv_usec))
+		end = pn->endtime;
+	printtime(dtime(&dtimeval, &jn->procs->bgtime, &end), &ti, "total");
+    }
 }
 
 /**/
@@ -969,8 +1164,20 @@ shelltime(void)
 {
     struct timeinfo ti;
     struct timezone dummy_tz;
+#ifdef WAIT_RUSAGE
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    rusagetime(&ti, &ru);
+    gettimeofday(&now, &dummy_tz);
+    printtime(dtime(&dtimeval, &shtimer, &now), &ti, "shell");
+    getrusage(RUSAGE_CHILDREN, &ru);
+    rusagetime(&ti, &ru);
+    printtime(dtime(&dtimeval, &shtimer, &now), &ti, "children");
+#else
     struct tms buf;
 
+    memset(&ti, 0, sizeof(struct timeinfo));
     times(&buf);
     ti.ut = buf.tms_utime;
     ti.st = buf.tms_stime;
@@ -979,6 +1186,7 @@ shelltime(void)
     ti.ut = buf.tms_cutime;
     ti.st = buf.tms_cstime;
     printtime(dtime(&dtimeval, &shtimer, &now), &ti, "children");
+#endif
 }
 
 /* see if jobs need printing */
@@ -989,7 +1197,7 @@ scanjobs(void)
 {
     int i;
  
-    for (i = 1; i < MAXJOB; i++)
+    for (i = 1; i < jobtabsize; i++)
         if (jobtab[i].stat & STAT_CHANGED)
             printjob(jobtab + i, 0, 1);
 }
@@ -1002,11 +1210,11 @@ checkjobs(void)
 {
     int i;
 
-    for (i = 1; i < MAXJOB; i++)
+    for (i = 1; i < jobtabsize; i++)
 	if (i != thisjob && (jobtab[i].stat & STAT_LOCKED) &&
 	    !(jobtab[i].stat & STAT_NOPRINT))
 	    break;
-    if (i < MAXJOB) {
+    if (i < jobtabsize) {
 	if (jobtab[i].stat & STAT_STOPPED) {
 
 #ifdef USE_SUSPENDED
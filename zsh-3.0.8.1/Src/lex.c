@@ -277,7 +277,15 @@ ctxtlex(void)
 #define LX2_OTHER 18
 #define LX2_META 19
 
-unsigned char lexact1[256], lexact2[256], lextok2[256];
+/* Classes of characters which may be read in runs, without going *
+ * through the switch for each of them.  See addrun().            */
+
+#define LR_WORD    1	/* plain character in an unquoted word   */
+#define LR_DQUOTE  2	/* plain character in double quotes      */
+#define LR_QUOTE   4	/* plain character in single quotes      */
+#define LR_COMMENT 8	/* anything but the end of a comment     */
+
+unsigned char lexact1[256], lexact2[256], lextok2[256], lexrun[256];
 
 /**/
 void
@@ -286,6 +294,7 @@ initlextabs(void)
     int t0;
     static char *lx1 = "\\q\n;!&|(){}[]<>";
     static char *lx2 = ";)|$[]~({}><=\\\'\"`,";
+    static char *lxdq = "\\\n$}`'()[]\"";
 
     for (t0 = 0; t0 != 256; t0++) {
 	lexact1[t0] = LX1_OTHER;
@@ -306,6 +315,22 @@ initlextabs(void)
     lextok2['~'] = Tilde;
     lextok2['#'] = Pound;
     lextok2['^'] = Hat;
+
+    /* Tokens are skipped by ingetc(), so they are never part of a *
+     * run.  The character after a Meta can't end a quoted string, *
+     * but may look like a blank, so Meta only ends unquoted runs. */
+    for (t0 = 0; t0 != 256; t0++) {
+	if (imeta(t0) && t0 != STOUC(Meta))
+	    continue;
+	lexrun[t0] = LR_DQUOTE | LR_QUOTE | LR_COMMENT;
+	if (lexact2[t0] == LX2_OTHER && lextok2[t0] == t0 &&
+	    !inblank(t0) && t0 != STOUC(Meta))
+	    lexrun[t0] |= LR_WORD;
+    }
+    for (t0 = 0; lxdq[t0]; t0++)
+	lexrun[STOUC(lxdq[t0])] &= ~LR_DQUOTE;
+    lexrun['\''] &= ~LR_QUOTE;
+    lexrun['\n'] &= ~(LR_QUOTE | LR_COMMENT);
 }
 
 /* initialize lexical state */
@@ -320,6 +345,51 @@ lexinit(void)
     tok = ENDINPUT;
 }
 
+/* Find the run of characters of class cls at the head of the input, *
+ * returning a pointer to it and its length in *np, or NULL if there *
+ * is none.  Unless history is stopped, bangchar ends the run as it  *
+ * needs hgetc() to look at it.                                      */
+
+static char *
+lexpeek(int cls, int *np)
+{
+    char *s, *t, *e;
+    int n;
+
+    if (!(s = hgetrun(&n)))
+	return NULL;
+    for (t = s, e = s + n; t < e && (lexrun[STOUC(*t)] & cls); t++)
+	if (*t == bangchar && stophist < 2 && cls != LR_COMMENT)
+	    break;
+    return (*np = t - s) ? s : NULL;
+}
+
+/* Add the run of characters of class cls at the head of the input *
+ * to the string buffer in one go.  Returns the number added.      */
+
+static int
+addrun(int cls)
+{
+    char *s;
+    int n;
+
+    if (!(s = lexpeek(cls, &n)))
+	return 0;
+    if (len + n >= bsiz) {
+	int newbsiz = bsiz * 8;
+
+	while (newbsiz <= len + n)
+	    newbsiz *= 2;
+	bptr = len + (tokstr = (char *)hrealloc(tokstr, bsiz, newbsiz));
+	bsiz = newbsiz;
+    }
+    memcpy(bptr, s, n);
+    bptr += n;
+    len += n;
+    hskiprun(s, n);
+    return n;
+}
+
 /* add a char to the string buffer */
 
 /**/
@@ -433,7 +503,14 @@ gettok(void)
 	/* History is handled here to prevent extra  *
 	 * newlines being inserted into the history. */
 
-	while ((c = ingetc()) != '\n' && !lexstop) {
+	for (;;) {
+	    char *s;
+	    int n;
+
+	    if ((s = lexpeek(LR_COMMENT, &n)))
+		hskiprun(s, n);
+	    if ((c = ingetc()) == '\n' || lexstop)
+		break;
 	    hwaddc(c);
 	    addtoline(c);
 	}
@@ -960,6 +1037,7 @@ gettokstr(int c, int sub)
 			    break;
 		    }
 		    add(c);
+		    addrun(LR_QUOTE);
 		}
 		ALLOWHIST
 		if (c != '\'') {
@@ -1030,6 +1108,11 @@ gettokstr(int c, int sub)
 	    break;
 	}
 	add(c);
+	if ((e = addrun(LR_WORD))) {
+	    /* as if each character had gone round the loop */
+	    fdpar = 0;
+	    intpos = (intpos > e) ? intpos - e : 0;
+	}
 	c = hgetc();
 	if (intpos)
 	    intpos--;
@@ -1171,6 +1254,7 @@ dquote_parse(char endchar, int sub)
 	if (err || lexstop)
 	    break;
 	add(c);
+	addrun(LR_DQUOTE);
     }
     if (intick == 2)
 	ALLOWHIST
@@ -29,6 +29,237 @@
 
 #include "zsh.h"
 
+/* Copy the output an iteration of for -P -o left in nam to *
+ * standard output, then remove the file.                   */
+
+static void
+parforcat(char *nam)
+{
+    char buf[BUFSIZ];
+    int fd, n, w, o;
+
+    if ((fd = open(nam, O_RDONLY)) != -1) {
+	while ((n = read(fd, buf, BUFSIZ)) > 0 ||
+	       (n < 0 && errno == EINTR))
+	    for (o = 0; o < n; o += w)
+		if ((w = write(1, buf + o, n - o)) < 0) {
+		    if (errno != EINTR)
+			break;
+		    w = 0;
+		}
+	close(fd);
+    }
+    unlink(nam);
+}
+
+/* State of a for -P loop:  which job runs in each slot and for *
+ * which iteration, the statuses of the iterations that have    *
+ * finished and, with -o, the files holding their output.       */
+
+struct parfor {
+    int nslots;			/* most jobs to run at once            */
+    int *slots;			/* job number running in each slot     */
+    int *iters;			/* iteration running in each slot      */
+    int *stats;			/* status of each finished iteration   */
+    int *done;			/* which iterations have finished      */
+    char **outs;		/* output file of each iteration       */
+    int started;		/* number of iterations started        */
+    int shown;			/* number of outputs copied out        */
+    int running;		/* number of slots in use              */
+};
+
+/* Wait until one of the jobs of a for -P loop has finished, note *
+ * its status, and return the slot it leaves free.  If we have    *
+ * been interrupted, pass the signal on to the jobs still running *
+ * so that we do not wait for them for long.                      */
+
+static int
+parforreap(struct parfor *pf)
+{
+    Job jn;
+    Process pn;
+    int i, killed = 0;
+
+    child_block();
+    for (;;) {
+	for (i = 0; i < pf->nslots; i++)
+	    if (pf->slots[i] && (jobtab[pf->slots[i]].stat & STAT_DONE))
+		break;
+	if (i < pf->nslots)
+	    break;
+	if ((errflag || breaks) && !killed) {
+	    for (i = 0; i < pf->nslots; i++)
+		if (pf->slots[i])
+		    killjb(jobtab + pf->slots[i], SIGINT);
+	    killed = 1;
+	}
+	child_suspend(SIGINT);
+	child_block();
+    }
+    child_unblock();
+
+    jn = jobtab + pf->slots[i];
+    for (pn = jn->procs; pn->next; pn = pn->next);
+    pf->stats[pf->iters[i]] = WIFSIGNALED(pn->status) ?
+	0200 | WTERMSIG(pn->status) : WEXITSTATUS(pn->status);
+    pf->done[pf->iters[i]] = 1;
+    deletejob(jn);
+    pf->slots[i] = 0;
+    pf->running--;
+
+    /* copy out the output of the iterations now done in order */
+    if (pf->outs)
+	while (pf->shown < pf->started && pf->done[pf->shown]) {
+	    parforcat(pf->outs[pf->shown]);
+	    zsfree(pf->outs[pf->shown++]);
+	}
+    return i;
+}
+
+/* Start the list of a for -P loop as a job of its own in the *
+ * free slot given.  Returns nonzero on failure.              */
+
+static int
+parforspawn(struct parfor *pf, int slot, List list)
+{
+    int job, oldjob, fd = -1;
+    pid_t pid;
+
+    if (pf->outs) {
+	char *nam = gettempname();
+
+	if (!nam || (fd = open(nam, O_WRONLY | O_CREAT | O_EXCL,
+			       0600)) == -1) {
+	    zerr("can't create temp file: %e", NULL, errno);
+	    return 1;
+	}
+	pf->outs[pf->started] = ztrdup(nam);
+    }
+    child_block();
+    if ((job = initjob()) == -1) {
+	child_unblock();
+	if (fd != -1)
+	    close(fd);
+	return 1;
+    }
+    jobtab[job].stat |= STAT_NOPRINT;
+    oldjob = thisjob;
+    thisjob = job;
+    if (!(pid = zfork())) {
+	entersubsh(Z_ASYNC, 1, 0);
+	if (fd != -1)
+	    redup(fd, 1);
+	execlist((List) dupstruct(list), 0, 1);
+	fflush(stdout);
+	_exit(lastval);
+    }
+    if (pid != -1)
+	addproc(pid, NULL);
+    thisjob = oldjob;
+    child_unblock();
+    if (fd != -1)
+	close(fd);
+    if (pid == -1) {
+	deletejob(jobtab + job);
+	return 1;
+    }
+    pf->slots[slot] = job;
+    pf->iters[slot] = pf->started++;
+    pf->running++;
+    return 0;
+}
+
+/* for -P: run each iteration in a subshell in the background, *
+ * with no more than a given number of them running at once.   */
+
+static int
+execparfor(Cmd cmd, LinkList args)
+{
+    struct parfor pf;
+    Forcmd node = cmd->u.forcmd;
+    char *str;
+    int nargs, slot, i, ret = 0;
+
+    str = dupstring(node->parmax);
+    singsub(&str);
+    if (errflag)
+	return lastval = 1;
+    untokenize(str);
+    pf.nslots = (int) matheval(str);
+    if (errflag)
+	return lastval = 1;
+    if (pf.nslots < 1) {
+	zerr("bad number of parallel jobs: %s", str, 0);
+	return lastval = 1;
+    }
+    nargs = countlinknodes(args);
+    if (pf.nslots > nargs)
+	pf.nslots = nargs;
+    pf.slots = (int *) zcalloc((pf.nslots + 1) * sizeof(int));
+    pf.iters = (int *) zcalloc((pf.nslots + 1) * sizeof(int));
+    pf.stats = (int *) zcalloc((nargs + 1) * sizeof(int));
+    pf.done = (int *) zcalloc((nargs + 1) * sizeof(int));
+    pf.outs = (node->parflags & FORP_ORDER) ?
+	(char **) zcalloc((nargs + 1) * sizeof(char *)) : NULL;
+    pf.started = pf.shown = pf.running = 0;
+
+    lastval = 0;
+    loops++;
+    pushheap();
+    while (!errflag && !breaks && (str = (char *)ugetnode(args))) {
+	if (pf.running == pf.nslots)
+	    slot = parforreap(&pf);
+	else
+	    for (slot = 0; pf.slots[slot]; slot++);
+	if (errflag || breaks)
+	    break;
+	setsparam(node->name, ztrdup(str));
+	if (parforspawn(&pf, slot, node->list))
+	    break;
+	freeheap();
+    }
+    popheap();
+    while (pf.running)
+	parforreap(&pf);
+    if (breaks)
+	breaks--;
+    loops--;
+
+    if (pf.outs) {
+	/* files of iterations interrupted or never started */
+	for (i = pf.shown; i <= pf.started; i++)
+	    if (pf.outs[i]) {
+		unlink(pf.outs[i]);
+		zsfree(pf.outs[i]);
+	    }
+	zfree(pf.outs, (nargs + 1) * sizeof(char *));
+    }
+    for (i = 0; i < pf.started; i++)
+	if (pf.stats[i]) {
+	    ret = pf.stats[i];
+	    break;
+	}
+    if (node->parstat) {
+	char **arr = (char **) zalloc((pf.started + 1) * sizeof(char *));
+	char buf[DIGBUFSIZE];
+
+	for (i = 0; i < pf.started; i++) {
+	    sprintf(buf, "%d", pf.stats[i]);
+	    arr[i] = ztrdup(buf);
+	}
+	arr[pf.started] = NULL;
+	setaparam(node->parstat, arr);
+    }
+    zfree(pf.slots, (pf.nslots + 1) * sizeof(int));
+    zfree(pf.iters, (pf.nslots + 1) * sizeof(int));
+    zfree(pf.stats, (nargs + 1) * sizeof(int));
+    zfree(pf.done, (nargs + 1) * sizeof(int));
+
+    if (!ret && (errflag || pf.started < nargs))
+	ret = 1;
+    return lastval = ret;
+}
+
 /**/
 int
 execfor(Cmd cmd)
@@ -47,6 +278,8 @@ execfor(Cmd cmd)
 	for (x = pparams; *x; x++)
 	    addlinknode(args, ztrdup(*x));
     }
+    if (node->parmax)
+	return execparfor(cmd, args);
     lastval = 0;
     loops++;
     pushheap();
@@ -101,6 +334,7 @@ execselect(Cmd cmd)
     inp = fdopen(dup(usezle ? SHTTY : 0), "r");
     for (;;) {
 	do {
+	    fflush(stdout);
 	    selectlist(args);
 	    if (empty(bufstack)) {
 	    	if (usezle) {
@@ -383,9 +383,10 @@ par_cmd(void)
 }
 
 /*
- * for	: ( FOR[EACH] | SELECT ) name ( "in" wordlist | INPAR wordlist OUTPAR )
+ * for	: ( FOR [ forpar ] | FOREACH | SELECT ) name ( "in" wordlist | INPAR wordlist OUTPAR )
 				{ SEPER } ( DO list DONE | INBRACE list OUTBRACE |
 				list ZEND | list1 )
+ * forpar : "-P" STRING { "-o" | "-s" name }
  */
 
 /**/
@@ -399,6 +400,26 @@ par_for(Cmd c)
     c->type = (tok == SELECT) ? CSELECT : CFOR;
     incmdpos = 0;
     yylex();
+    if (tok == STRING && c->type == CFOR && !csh && !strcmp(tokstr, "-P")) {
+	yylex();
+	if (tok != STRING)
+	    YYERRORV;
+	f->parmax = tokstr;
+	for (;;) {
+	    yylex();
+	    if (tok != STRING)
+		break;
+	    if (!strcmp(tokstr, "-o"))
+		f->parflags |= FORP_ORDER;
+	    else if (!strcmp(tokstr, "-s")) {
+		yylex();
+		if (tok != STRING || !isident(tokstr))
+		    YYERRORV;
+		f->parstat = tokstr;
+	    } else
+		break;
+	}
+    }
     if (tok != STRING || !isident(tokstr))
 	YYERRORV;
     f->name = tokstr;
@@ -302,9 +302,15 @@ signal_suspend(int sig, int sig2)
 {
     int ret;
  
-#ifdef POSIX_SIGNALS
+#if defined(POSIX_SIGNALS) || defined(BSD_SIGNALS)
     sigset_t set;
+#endif
+
+    /* Whatever we are waiting for may write to the same place, *
+     * so our own output must go out before theirs.             */
+    fflush(stdout);
 
+#ifdef POSIX_SIGNALS
     sigfillset(&set);
     sigdelset(&set, sig);
     sigdelset(&set, SIGHUP);  /* still don't know why we add this? */
@@ -313,8 +319,6 @@ signal_suspend(int sig, int sig2)
     ret = sigsuspend(&set);
 #else
 # ifdef BSD_SIGNALS
-    sigset_t set;
-
     sigfillset(&set);
     sigdelset(&set, sig);
     if (sig2)
@@ -353,6 +357,115 @@ signal_suspend(int sig, int sig2)
 # endif
 #endif
 
+/* most children to reap before passing them on to their jobs */
+
+#define REAPBATCH 16
+
+/* If pid was a command or process substitution, save its status *
+ * where the code waiting for it will look, and return 1.         */
+
+static int
+reapprocsub(pid_t pid, int status)
+{
+    pid_t *procsubpid = &cmdoutpid;
+    int *procsubval = &cmdoutval;
+    struct execstack *es = exstack;
+
+    for (;;) {
+	if (pid == *procsubpid) {
+	    *procsubpid = 0;
+	    if (WIFSIGNALED(status))
+		*procsubval = (0200 | WTERMSIG(status));
+	    else
+		*procsubval = WEXITSTATUS(status);
+	    return 1;
+	}
+	if (!es)
+	    return 0;
+	procsubpid = &es->cmdoutpid;
+	procsubval = &es->cmdoutval;
+	es = es->next;
+    }
+}
+
+/* Reap every child that has exited or stopped.  Children are *
+ * collected a batch at a time before their processes and     *
+ * jobs are updated, so that the time of day is looked at     *
+ * once per batch, and each job is updated only once however  *
+ * many of its processes have ended.                          */
+
+static void
+reapchildren(void)
+{
+    struct {
+	pid_t pid;
+	int status;
+	struct timeinfo ti;
+    } reaped[REAPBATCH];
+    int jobs[REAPBATCH];
+    int old_errno = errno;	/* save the errno, since WAIT may change it */
+    int n, nj, i, j, status;
+    pid_t pid;
+    struct timeval now;
+    struct timezone dummy_tz;
+    Job jn;
+    Process pn;
+#ifdef WAIT_RUSAGE
+    struct rusage ru;
+#else
+    long childs, childu;
+#endif
+
+    do {
+	/* keep WAITING until no more child processes to reap */
+	for (n = 0; n < REAPBATCH; ) {
+#ifdef WAIT_RUSAGE
+	    pid = wait3((void *) &status, WNOHANG|WUNTRACED, &ru);
+#else
+	    childs = shtms.tms_cstime;
+	    childu = shtms.tms_cutime;
+	    pid = WAIT(-1, &status, WNOHANG|WUNTRACED);
+	    times(&shtms);
+#endif
+	    if (pid == -1 && errno != ECHILD)
+		zerr("wait failed: %e", NULL, errno);
+	    if (pid <= 0)
+		break;
+	    if (reapprocsub(pid, status))
+		continue;
+	    reaped[n].pid = pid;
+	    reaped[n].status = status;
+#ifdef WAIT_RUSAGE
+	    rusagetime(&reaped[n].ti, &ru);
+#else
+	    memset(&reaped[n].ti, 0, sizeof(struct timeinfo));
+	    reaped[n].ti.ut = shtms.tms_cutime - childu;
+	    reaped[n].ti.st = shtms.tms_cstime - childs;
+#endif
+	    n++;
+	}
+	if (!n)
+	    break;
+
+	/* Find the process and job containing each pid and update *
+	 * them.  Others were not ours to keep track of.           */
+	gettimeofday(&now, &dummy_tz);
+	for (i = nj = 0; i < n; i++)
+	    if (findproc(reaped[i].pid, &jn, &pn)) {
+		update_process(pn, reaped[i].status, &reaped[i].ti, &now);
+		for (j = 0; j < nj && jobs[j] != jn - jobtab; j++);
+		if (j == nj)
+		    jobs[nj++] = jn - jobtab;
+	    }
+	/* jobs are looked up by number, as traps run by update_job() *
+	 * may move the job table                                     */
+	for (j = 0; j < nj; j++)
+	    if (jobtab[jobs[j]].stat)
+		update_job(jobtab + jobs[j]);
+    } while (n == REAPBATCH);
+    errno = old_errno;
+}
+
 /* the signal handler */
  
 /**/
@@ -398,62 +511,7 @@ handler(int sig)
  
     switch (sig) {
     case SIGCHLD:
-
-	/* keep WAITING until no more child processes to reap */
-	for (;;)
-	  cont: {
-            int old_errno = errno; /* save the errno, since WAIT may change it */
-	    int status;
-	    Job jn;
-	    Process pn;
-            pid_t pid;
-	    pid_t *procsubpid = &cmdoutpid;
-	    int *procsubval = &cmdoutval;
-	    struct execstack *es = exstack;
-
-            pid = WAIT(-1, &status, WNOHANG|WUNTRACED);  /* reap the child process */
-
-            if (!pid)  /* no more children to reap */
-                break;
-
-	    /* check if child returned was from process substitution */
-	    for (;;) {
-		if (pid == *procsubpid) {
-		    *procsubpid = 0;
-		    if (WIFSIGNALED(status))
-			*procsubval = (0200 | WTERMSIG(status));
-		    else
-			*procsubval = WEXITSTATUS(status);
-		    times(&shtms);
-		    goto cont;
-		}
-		if (!es)
-		    break;
-		procsubpid = &es->cmdoutpid;
-		procsubval = &es->cmdoutval;
-		es = es->next;
-	    }
-
-	    /* check for WAIT error */
-            if (pid == -1) {
-                if (errno != ECHILD)
-                    zerr("wait failed: %e", NULL, errno);
-                errno = old_errno;    /* WAIT changed errno, so restore the original */
-                break;
-            }
-
-	    /* Find the process and job containing this pid and update it. */
-	    if (findproc(pid, &jn, &pn)) {
-		update_process(pn, status);
-		update_job(jn);
-	    } else {
-		/* If not found, update the shell record of time spent by
-		 * children in sub processes anyway:  otherwise, this
-		 * will get added on to the next found process that terminates.
-		 */
-		times(&shtms);
-	    }
-        }
+	reapchildren();
         break;
  
     case SIGHUP:
@@ -536,7 +594,7 @@ killrunjobs(int from_signal)
  
     if (unset(HUP))
         return;
-    for (i = 1; i < MAXJOB; i++)
+    for (i = 1; i < jobtabsize; i++)
         if ((from_signal || i != thisjob) && (jobtab[i].stat & STAT_LOCKED) &&
             !(jobtab[i].stat & STAT_NOPRINT) &&
             !(jobtab[i].stat & STAT_STOPPED)) {
@@ -702,7 +760,7 @@ dotrapargs(int sig, int *sigtr, void *sigfn)
 	    addlinknode(args, num);
 	} LASTALLOC;
 	trapreturn = -1;
-	doshfunc(sigfn, args, 0, 1);
+	doshfunc(name, sigfn, args, 0, 1);
 	freelinklist(args, (FreeFunc) NULL);
 	zsfree(name);
     } else HEAPALLOC {
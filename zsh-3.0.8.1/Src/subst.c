@@ -1146,15 +1146,17 @@ paramsubst(LinkList l, LinkNode n, char **str, int qt, int ssub)
 		    *s == '=' || *s == Equals ||
 		    *s == '%' ||
 		    *s == '#' || *s == Pound ||
-		    *s == '?' || *s == Quest)) {
+		    *s == '?' || *s == Quest ||
+		    (*s == '/' && !colf))) {
 
 	if (!flnum)
 	    flnum++;
 	if (*s == '%')
 	    flags |= 1;
 
-	/* Check for ${..%%..} or ${..##..} */
-	if ((*s == '%' || *s == '#' || *s == Pound) && *s == s[1]) {
+	/* Check for ${..%%..}, ${..##..} or ${..//..} */
+	if ((*s == '%' || *s == '#' || *s == Pound || *s == '/') &&
+	    *s == s[1]) {
 	    s++;
 	    doub = 1;
 	}
@@ -1286,6 +1288,40 @@ paramsubst(LinkList l, LinkNode n, char **str, int qt, int ssub)
 		copied = 1;
 	    }
 	    break;
+	case '/':
+	    {
+		/* ${..//..} replaces all matches, not just the first */
+		char *r;
+
+		for (r = s; *r && *r != '/'; r++)
+		    if ((*r == Bnull || *r == '\\') && r[1])
+			r++;
+		if (*r)
+		    *r++ = '\0';
+		else
+		    r = dupstring("");
+		if (qt && (parse_subst_string(s) || parse_subst_string(r))) {
+		    zerr("parse error in ${.../...} substitution", NULL, 0);
+		    return NULL;
+		}
+		singsub(&s);
+		singsub(&r);
+		untokenize(r);
+
+		if (!vunset && isarr) {
+		    char **ap = aval;
+		    char **pp = aval = (char **)ncalloc(sizeof(char *) * (arrlen(aval) + 1));
+
+		    while ((*pp = *ap++))
+			getmatchrepl(pp++, s, r, doub);
+		} else {
+		    if (vunset)
+			val = dupstring("");
+		    getmatchrepl(&val, s, r, doub);
+		}
+		copied = 1;
+	    }
+	    break;
 	}
     } else {			/* no ${...=...} or anything, but possible modifiers. */
 	if (chkset) {
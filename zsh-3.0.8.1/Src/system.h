@@ -27,6 +27,11 @@
  *
  */
 
+/* splice(), tee() and memfd_create() are GNU extensions */
+#if (defined(HAVE_SPLICE) && defined(HAVE_TEE)) || defined(HAVE_MEMFD_CREATE)
+#define _GNU_SOURCE
+#endif
+
 #ifdef __hpux
 #define _INCLUDE_POSIX_SOURCE
 #define _INCLUDE_XOPEN_SOURCE
@@ -170,6 +175,10 @@ struct timezone {
 # include <sys/file.h>
 #endif
 
+#ifdef HAVE_MEMFD_CREATE
+# include <sys/mman.h>
+#endif
+
 /* The following will only be defined if <sys/wait.h> is POSIX.    *
  * So we don't have to worry about union wait. But some machines   *
  * (NeXT) include <sys/wait.h> from other include files, so we     *
@@ -361,6 +370,10 @@ struct timezone {
 
 #ifdef HAVE_SYS_RESOURCE_H
 # include <sys/resource.h>
+/* wait3() also hands back the resources used by the child */
+# ifdef HAVE_WAIT3
+#  define WAIT_RUSAGE
+# endif
 # if defined(__hpux) && !defined(RLIMIT_CPU)
 /* HPUX does have the BSD rlimits in the kernel.  Officially they are *
  * unsupported but quite a few of them like RLIMIT_CORE seem to work. *
@@ -233,6 +233,17 @@ gettext2(struct node *n)
 	case CFOR:
 	case CSELECT:
 	    taddstr((nn->type == CFOR) ? "for " : "select ");
+	    if (nn->u.forcmd->parmax) {
+		taddstr("-P ");
+		taddstr(nn->u.forcmd->parmax);
+		if (nn->u.forcmd->parflags & FORP_ORDER)
+		    taddstr(" -o");
+		if (nn->u.forcmd->parstat) {
+		    taddstr(" -s ");
+		    taddstr(nn->u.forcmd->parstat);
+		}
+		taddchr(' ');
+	    }
 	    taddstr(nn->u.forcmd->name);
 	    if (nn->u.forcmd->inflag) {
 		taddstr(" in ");
@@ -61,6 +61,7 @@ zwarn(char *fmt, char *str, int num)
 {
     if (errflag || noerrs)
 	return;
+    fflush(stdout);
     trashzle();
     /*
      * scriptname is set when sourcing scripts, so that we get the
@@ -80,6 +81,7 @@ zwarnnam(char *cmd, char *fmt, char *str, int num)
 {
     if (errflag || noerrs)
 	return;
+    fflush(stdout);
     trashzle();
     if (unset(SHINSTDIN) || locallevel) {
 	nicezputs(scriptname ? scriptname : argzero, stderr);
@@ -428,22 +430,6 @@ get_username(void)
 
 static char finddir_full[PATH_MAX];
 static Nameddir finddir_last;
-static int finddir_best;
-
-/* ScanFunc used by finddir(). */
-
-static void finddir_scan _((HashNode, int));
-
-static void
-finddir_scan(HashNode hn, int flags)
-{
-    Nameddir nd = (Nameddir) hn;
-
-    if(nd->diff > finddir_best && !dircmp(nd->dir, finddir_full)) {
-	finddir_last=nd;
-	finddir_best=nd->diff;
-    }
-}
 
 /* See if a path has a named directory as its prefix. *
  * If passed a NULL argument, it will invalidate any  *
@@ -454,6 +440,7 @@ Nameddir
 finddir(char *s)
 {
     static struct nameddir homenode = { NULL, "", 0, NULL, 0 };
+    Nameddir nd;
 
     /* Invalidate directory cache if argument is NULL.  This is called *
      * whenever a node is added to or removed from the hash table, and *
@@ -471,10 +458,12 @@ finddir(char *s)
 	return finddir_last;
 
     strcpy(finddir_full, s);
-    finddir_best=0;
     finddir_last=NULL;
-    finddir_scan((HashNode)&homenode, 0);
-    scanhashtable(nameddirtab, 0, 0, 0, finddir_scan, 0);
+    if (homenode.diff > 0 && !dircmp(homenode.dir, finddir_full))
+	finddir_last = &homenode;
+    if ((nd = findnameddir(finddir_full,
+			   finddir_last ? finddir_last->diff : 0)))
+	finddir_last = nd;
     return finddir_last;
 }
 
@@ -615,7 +604,7 @@ preprompt(void)
 	 * to turn off the exit check.
 	 */
 	int osm = stopmsg;
-	doshfunc(list, NULL, 0, 1);
+	doshfunc("precmd", list, NULL, 0, 1);
 	stopmsg = osm;
     }
     if (errflag)
@@ -626,7 +615,7 @@ preprompt(void)
      * executed "periodic", then execute it now.                    */
     if (period && (time(NULL) > lastperiodic + period) &&
 	(list = getshfunc("periodic"))) {
-	doshfunc(list, NULL, 0, 1);
+	doshfunc("periodic", list, NULL, 0, 1);
 	lastperiodic = time(NULL);
     }
     if (errflag)
@@ -1053,6 +1042,10 @@ movefd(int fd)
 void
 redup(int x, int y)
 {
+    if (y == 1) {
+	fflush(stdout);
+	ttystdout = 0;
+    }
     if(x < 0)
 	zclose(y);
     else if (x != y) {
@@ -1072,6 +1065,10 @@ int
 zclose(int fd)
 {
     if (fd >= 0) {
+	if (fd == 1) {
+	    fflush(stdout);
+	    ttystdout = 0;
+	}
 	fdtable[fd] = 0;
 	while (max_zsh_fd > 0 && !fdtable[max_zsh_fd])
 	    max_zsh_fd--;
@@ -1403,6 +1400,47 @@ getquery(char *valid_chars)
 static int d;
 static char *guess, *best;
 
+/* Spelling correction compares the word with a lot of names, most  *
+ * of which are nowhere near it.  Each step spdist() takes adds or   *
+ * removes at most one character on each side and costs at least    *
+ * half of that, and there are no more steps than its threshold.     *
+ * So the lengths and the sets of characters (folded into the bits   *
+ * of a word, ignoring case) of two names within a given distance    *
+ * can't differ by more than that allows, which is cheap to check.   */
+
+static unsigned
+spsig(char *s, int *lenp)
+{
+    unsigned sig = 0;
+    char *t;
+
+    for (t = s; *t; t++)
+	sig |= 1U << (tulower(*t) & 31);
+    *lenp = t - s;
+    return sig;
+}
+
+/* Could s be no further than dist from the guess with signature *
+ * gsig and length glen?                                         */
+
+static int
+sppossible(char *s, unsigned gsig, int glen, int dist)
+{
+    unsigned x;
+    int len, dl, n, lim = glen / 4 + 1;
+
+    if (dist < lim)
+	lim = dist;
+    x = spsig(s, &len) ^ gsig;
+    dl = (len > glen) ? len - glen : glen - len;
+    if (dl > lim || 2 * dl > dist)
+	return 0;
+    for (n = 0; x; x &= x - 1)
+	if (++n > 2 * lim)
+	    return 0;
+    return 1;
+}
+
 /**/
 void
 spscan(HashNode hn, int scanflags)
@@ -1416,6 +1454,22 @@ spscan(HashNode hn, int scanflags)
     }
 }
 
+/* Run spscan() over the names in a hash table which could be closer *
+ * to the guess than the best one so far, in the order of the names. */
+
+static void
+spscantable(HashTable ht)
+{
+    HashNode *hp;
+    unsigned gsig;
+    int n, glen;
+
+    gsig = spsig(guess, &glen);
+    for (hp = gethashprefix(ht, "", 0, &n); n--; hp++)
+	if (sppossible((*hp)->nam, gsig, glen, d))
+	    spscan(*hp, 0);
+}
+
 /* spellcheck a word */
 /* fix s ; if hist is nonzero, fix the history list too */
 
@@ -1464,7 +1518,7 @@ spckword(char **s, int hist, int cmd, int ask)
 	    return;
 	ic = String;
 	d = 100;
-	scanhashtable(paramtab, 1, 0, 0, spscan, 0);
+	spscantable(paramtab);
     } else if (**s == Equals) {
 	if (*t)
 	    return;
@@ -1472,8 +1526,8 @@ spckword(char **s, int hist, int cmd, int ask)
 	    return;
 	d = 100;
 	ic = Equals;
-	scanhashtable(aliastab, 1, 0, 0, spscan, 0);
-	scanhashtable(cmdnamtab, 1, 0, 0, spscan, 0);
+	spscantable(aliastab);
+	spscantable(cmdnamtab);
     } else {
 	guess = *s;
 	if (*guess == Tilde || *guess == String) {
@@ -1497,11 +1551,11 @@ spckword(char **s, int hist, int cmd, int ask)
 	    if (hashcmd(guess, pathchecked))
 		return;
 	    d = 100;
-	    scanhashtable(reswdtab, 1, 0, 0, spscan, 0);
-	    scanhashtable(aliastab, 1, 0, 0, spscan, 0);
-	    scanhashtable(shfunctab, 1, 0, 0, spscan, 0);
-	    scanhashtable(builtintab, 1, 0, 0, spscan, 0);
-	    scanhashtable(cmdnamtab, 1, 0, 0, spscan, 0);
+	    spscantable(reswdtab);
+	    spscantable(aliastab);
+	    spscantable(shfunctab);
+	    spscantable(builtintab);
+	    spscantable(cmdnamtab);
 	}
     }
     if (errflag)
@@ -1710,15 +1764,95 @@ skipwsep(char **s)
     return i;
 }
 
+/* The bytes findsep() has to stop at when splitting on IFS:  the   *
+ * separators which appear unmetafied, and Meta.  They are set up by *
+ * inittyptab() whenever IFS changes; if there are few enough of     *
+ * them, each holds the byte repeated through an unsigned long, so   *
+ * that skipnonsep() can check a whole word of the string at once.   */
+
+#define MAX_SEPSTOP 4
+static int nsepstop;
+static unsigned long sepstop[MAX_SEPSTOP];
+
+#define LONG_ONES  ((unsigned long)-1 / 0xff)
+#define LONG_HIGHS (LONG_ONES << 7)
+#define LONG_HASZERO(W) (((W) - LONG_ONES) & ~(W) & LONG_HIGHS)
+
+static void
+initsepstop(void)
+{
+    int t0;
+
+    for (nsepstop = t0 = 0; t0 != 256; t0++)
+	if ((isep(t0) && !imeta(t0)) || t0 == STOUC(Meta)) {
+	    if (nsepstop == MAX_SEPSTOP) {
+		nsepstop = 0;
+		return;
+	    }
+	    sepstop[nsepstop++] = LONG_ONES * t0;
+	}
+}
+
+/* Return a pointer to the first IFS separator, Meta or null byte *
+ * at or after t.  If e, the end of the string, is known, whole    *
+ * words are read as long as they lie before it; they are never    *
+ * read past the null byte, which may end the string's memory.     */
+
+static char *
+skipnonsep(char *t, char *e)
+{
+    unsigned long w, m;
+    int i;
+
+    if (nsepstop && e) {
+	for (; (size_t)t & (sizeof(unsigned long) - 1); t++)
+	    if (!*t || isep(*t) || *t == Meta)
+		return t;
+	for (; (size_t)(e - t) >= sizeof(unsigned long);
+	     t += sizeof(unsigned long)) {
+	    memcpy(&w, t, sizeof(unsigned long));
+	    for (m = LONG_HASZERO(w), i = 0; i < nsepstop; i++)
+		m |= LONG_HASZERO(w ^ sepstop[i]);
+	    if (m)
+		break;
+	}
+    }
+    while (*t && !isep(*t) && *t != Meta)
+	t++;
+    return t;
+}
+
+/* findsep(s, NULL) for a string ending at e (NULL if not known). */
+
+static int
+findifs(char **s, char *e)
+{
+    int i;
+    char *t;
+
+    for (t = *s; *(t = skipnonsep(t, e)) == Meta && !isep(t[1] ^ 32); t += 2);
+    i = t - *s;
+    *s = t;
+    return i;
+}
+
+/* Split s into words at IFS separators.  When allocating on the heap *
+ * the words are cut out of a single copy of s instead of being      *
+ * copied one by one.                                                */
+
 /**/
 char **
 spacesplit(char *s, int allownull)
 {
-    char *t, **ret, **ptr;
+    char *t, *e, *cut = NULL, **ret, **ptr;
+    int inplace = useheap;
 
     ptr = ret = (char **) ncalloc(sizeof(*ret) * (wordcount(s, NULL, -!allownull) + 1));
 
+    if (inplace)
+	s = dupstring(s);
     t = s;
+    e = s + strlen(s);
     skipwsep(&s);
     if (*s && isep(*s == Meta ? s[1] ^ 32 : *s))
 	*ptr++ = dupstring(allownull ? "" : nulstring);
@@ -1731,16 +1865,25 @@ spacesplit(char *s, int allownull)
 	    s++;
 	    skipwsep(&s);
 	}
+	/* the separator after the last word has been looked at */
+	if (cut)
+	    *cut = '\0', cut = NULL;
 	t = s;
-	findsep(&s, NULL);
+	findifs(&s, e);
 	if (s > t || allownull) {
-	    *ptr = (char *) ncalloc((s - t) + 1);
-	    ztrncpy(*ptr++, t, s - t);
+	    if (inplace)
+		*ptr++ = t, cut = s;
+	    else {
+		*ptr = (char *) ncalloc((s - t) + 1);
+		ztrncpy(*ptr++, t, s - t);
+	    }
 	} else
 	    *ptr++ = dupstring(nulstring);
 	t = s;
 	skipwsep(&s);
     }
+    if (cut)
+	*cut = '\0';
     if (!allownull && t != s)
 	*ptr++ = dupstring("");
     *ptr = NULL;
@@ -1754,19 +1897,8 @@ findsep(char **s, char *sep)
     int i;
     char *t, *tt;
 
-    if (!sep) {
-	for (t = *s; *t; t++) {
-	    if (*t == Meta) {
-		if (isep(t[1] ^ 32))
-		    break;
-		t++;
-	    } else if (isep(*t))
-		break;
-	}
-	i = t - *s;
-	*s = t;
-	return i;
-    }
+    if (!sep)
+	return findifs(s, NULL);
     if (!sep[0]) {
 	if (**s) {
 	    if (**s == Meta)
@@ -1777,19 +1909,16 @@ findsep(char **s, char *sep)
 	}
 	return -1;
     }
-    for (i = 0; **s; i++) {
-	for (t = sep, tt = *s; *t && *tt && *t == *tt; t++, tt++);
-	if (!*t)
+    for (i = 0, t = *s; (tt = strstr(t, sep)); ) {
+	/* a match in the middle of a Meta pair doesn't count */
+	for (; t < tt; i++)
+	    t += (*t == Meta) ? 2 : 1;
+	if (t == tt) {
+	    *s = t;
 	    return i;
-	if (*(*s)++ == Meta) {
-#ifdef DEBUG
-	    if (! *(*s)++)
-		fprintf(stderr, "BUG: unexpected end of string in findsep()\n");
-#else
-	    (*s)++;
-#endif
 	}
     }
+    *s = t + strlen(t);
     return -1;
 }
 
@@ -1837,7 +1966,7 @@ wordcount(char *s, char *sep, int mul)
 	    if ((c && *(s + sl)) || mul)
 		r++;
     } else {
-	char *t = s;
+	char *t = s, *e = s + strlen(s);
 
 	r = 0;
 	if (mul <= 0)
@@ -1853,7 +1982,7 @@ wordcount(char *s, char *sep, int mul)
 		if (mul <= 0)
 		    skipwsep(&s);
 	    }
-	    findsep(&s, NULL);
+	    findifs(&s, e);
 	    t = s;
 	    if (mul <= 0)
 		skipwsep(&s);
@@ -1897,7 +2026,7 @@ sepjoin(char **s, char *sep)
 char **
 sepsplit(char *s, char *sep, int allownull)
 {
-    int n, sl;
+    int n, sl, inplace;
     char *t, *tt, **r, **p;
 
     if (!sep)
@@ -1907,12 +2036,19 @@ sepsplit(char *s, char *sep, int allownull)
     n = wordcount(s, sep, 1);
     r = p = (char **) ncalloc((n + 1) * sizeof(char *));
 
+    /* cut the words out of a single copy of s unless sep is empty */
+    if ((inplace = useheap && sl))
+	s = dupstring(s);
     for (t = s; n--;) {
 	tt = t;
 	findsep(&t, sep);
-	*p = (char *) ncalloc(t - tt + 1);
-	strncpy(*p, tt, t - tt);
-	(*p)[t - tt] = '\0';
+	if (inplace)
+	    *p = tt, *t = '\0';
+	else {
+	    *p = (char *) ncalloc(t - tt + 1);
+	    strncpy(*p, tt, t - tt);
+	    (*p)[t - tt] = '\0';
+	}
 	p++;
 	t += sl;
     }
@@ -1972,7 +2108,7 @@ static int flagtab[N_COUNT] =
     NT_SET(N_CMD, 2, NT_STR | NT_LIST, NT_NODE, NT_NODE | NT_LIST, NT_NODE | NT_LIST),
     NT_SET(N_REDIR, 3, NT_STR, 0, 0, 0),
     NT_SET(N_COND, 1, NT_NODE, NT_NODE, 0, 0),
-    NT_SET(N_FOR, 1, NT_STR, NT_NODE, 0, 0),
+    NT_SET(N_FOR, 2, NT_STR, NT_NODE, NT_STR, NT_STR),
     NT_SET(N_CASE, 0, NT_STR | NT_ARR, NT_NODE | NT_ARR, 0, 0),
     NT_SET(N_IF, 0, NT_NODE | NT_ARR, NT_NODE | NT_ARR, 0, 0),
     NT_SET(N_WHILE, 1, NT_NODE, NT_NODE, 0, 0),
@@ -2461,8 +2597,11 @@ dupstruct2(void *a)
 	    Forcmd mf = (Forcmd) m;
 
 	    mf->inflag = nf->inflag;
+	    mf->parflags = nf->parflags;
 	    mf->name = (char *)dupnode(type, nf->name, 0);
 	    mf->list = (List) dupnode(type, nf->list, 1);
+	    mf->parmax = (char *)dupnode(type, nf->parmax, 2);
+	    mf->parstat = (char *)dupnode(type, nf->parstat, 3);
 	}
 	break;
     case N_CASE:
@@ -2578,6 +2717,8 @@ freestruct(void *a)
 
 	    freetreenode(type, nf->name, 0);
 	    freetreenode(type, nf->list, 1);
+	    freetreenode(type, nf->parmax, 2);
+	    freetreenode(type, nf->parstat, 3);
 	}
 	break;
     case N_CASE:
@@ -2781,6 +2922,7 @@ inittyptab(void)
 	}
 	typtab[STOUC(*s == Meta ? *++s ^ 32 : *s)] |= ISEP;
     }
+    initsepstop();
     for (s = wordchars ? wordchars : DEFAULT_WORDCHARS; *s; s++)
 	typtab[STOUC(*s == Meta ? *++s ^ 32 : *s)] |= IWORD;
     for (s = SPECCHARS; *s; s++)
@@ -2840,8 +2982,10 @@ spname(char *oldname)
 int
 mindist(char *dir, char *mindistguess, char *mindistbest)
 {
-    int mindistd, nd;
-    DIR *dd;
+    static char *dots[] = { ".", ".." };
+    int mindistd, nd, i, glen;
+    unsigned gsig;
+    Dircache dc;
     char *fn;
     char buf[PATH_MAX];
 
@@ -2853,11 +2997,15 @@ mindist(char *dir, char *mindistguess, char *mindistbest)
 	strcpy(mindistbest, mindistguess);
 	return 0;
     }
-    if (!(dd = opendir(unmeta(dir))))
+    if (!(dc = getdircache(dir, NULL)))
 	return mindistd;
-    while ((fn = zreaddir(dd))) {
-	nd = spdist(fn, mindistguess,
-		    (int)strlen(mindistguess) / 4 + 1);
+    gsig = spsig(mindistguess, &glen);
+    /* the directory cache leaves out `.' and `..' */
+    for (i = -2; i < dc->nents; i++) {
+	fn = (i < 0) ? dots[i + 2] : dc->names[i];
+	if (!sppossible(fn, gsig, glen, mindistd))
+	    continue;
+	nd = spdist(fn, mindistguess, glen / 4 + 1);
 	if (nd <= mindistd) {
 	    strcpy(mindistbest, fn);
 	    mindistd = nd;
@@ -2865,7 +3013,6 @@ mindist(char *dir, char *mindistguess, char *mindistbest)
 		break;
 	}
     }
-    closedir(dd);
     return mindistd;
 }
 
@@ -378,6 +378,52 @@ getkey(int keytmout)
     return ret;
 }
 
+/* Check, without blocking, whether there is a key waiting to be read, *
+ * either pushed back with ungetkey() or typed ahead on the terminal.  */
+
+/**/
+int
+keypending(void)
+{
+    return kungetct || ttykeypending();
+}
+
+/* Check only the terminal.  This is used by long-running widgets  *
+ * (completion) to give up as soon as the user types something:    *
+ * keys pushed back by a bindkey -s string were not typed just now. */
+
+/**/
+int
+ttykeypending(void)
+{
+#if defined(_WIN32)
+    return !waitkey(SHTTY, 0);
+#else
+# ifdef FIONREAD
+    {
+	int val = 0;
+
+	ioctl(SHTTY, FIONREAD, (char *)&val);
+	return val > 0;
+    }
+# else
+#  ifdef HAVE_SELECT
+    {
+	fd_set foofd;
+	struct timeval tv;
+
+	FD_ZERO(&foofd);
+	FD_SET(SHTTY, &foofd);
+	tv.tv_sec = tv.tv_usec = 0;
+	return select(SHTTY+1, (SELECT_ARG_2_T) & foofd, NULL, NULL, &tv) > 0;
+    }
+#  else
+    return 0;
+#  endif
+# endif
+#endif
+}
+
 /* Where to print out bindings:  either stdout, or the zle output shout */
 static FILE *bindout;
 
@@ -532,7 +578,9 @@ zleread(char *lp, char *rp)
 		    refresh();
 	    } else
 #endif
-		if (!kungetct)
+		/* Leave the screen alone while there is typeahead, *
+		 * so that a paste is only redrawn once at the end. */
+		if (!keypending())
 		    refresh();
 	}
 	statusline = NULL;
@@ -30,11 +30,43 @@
 #define ZLE
 #include "zsh.h"
 
+/* Insert any further self-inserting characters which are already   *
+ * waiting to be read, as happens when a block of text is pasted.   *
+ * They go into the line without going round the key loop in        *
+ * zleread() for each of them, so the screen is only redrawn once   *
+ * the run is over.  Each character still gets its own undo record, *
+ * just as if it had been typed on its own, so that what one undo   *
+ * takes back does not depend on how fast the keys came in.  The    *
+ * first key bound to something else is pushed back.                */
+
+static void
+selfinsertrun(void)
+{
+    int k;
+
+    while (keypending()) {
+	if ((k = getkey(0)) == EOF)
+	    break;
+	if (bindtab[k] != z_selfinsert) {
+	    ungetkey(k);
+	    if (vichgflag)
+		vichgbufptr--;
+	    break;
+	}
+	if (undoing)
+	    addundo();
+	c = k;
+	if (insmode || ll == cs)
+	    spaceinline(1);
+	line[cs++] = c;
+    }
+}
+
 /**/
 void
 selfinsert(void)
 {
-    int ncs = cs + zmult;
+    int ncs = cs + zmult, run = (zmult == 1 && !complexpect);
 
     if (complexpect && isset(AUTOPARAMKEYS)) {
 	if (complexpect == 2 && /*{*/ c == '}') {
@@ -71,6 +103,8 @@ selfinsert(void)
     while (zmult--)
 	line[cs++] = c;
     cs = ncs;
+    if (run && bindk == z_selfinsert)
+	selfinsertrun();
 }
 
 /**/
@@ -468,21 +502,19 @@ sendbreak(void)
 void
 undo(void)
 {
-    char *s;
     struct undoent *ue;
+    int oll = ll;
 
     ue = undos + undoct;
     if (!ue->change) {
 	feep();
 	return;
     }
-    line[ll] = '\0';
-    s = zalloc(ue->suff + 1);
-    memcpy(s, (char *)&line[ll - ue->suff], ue->suff);
     sizeline(ll = ue->pref + ue->suff + ue->len);
+    memmove((char *)line + ue->pref + ue->len,
+	    (char *)line + oll - ue->suff, ue->suff);
     memcpy((char *)line + ue->pref, ue->change, ue->len);
-    memcpy((char *)line + ue->pref + ue->len, s, ue->suff);
-    zfree(s, ue->suff + 1);
+    line[ll] = '\0';
     ue->change = NULL;
     undoct = (undoct + UNDOCT - 1) % UNDOCT;
     cs = ue->cs;
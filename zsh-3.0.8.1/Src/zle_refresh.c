@@ -299,7 +299,6 @@ refresh(void)
 	    vcs = 0;
 	    moveto(0, pptw);
 	}
-	fflush(shout);
 	clearf = clearflag;
     } else if (winw != columns || rwinh != lines)
 	resetvideo();
@@ -840,11 +839,14 @@ moveto(int ln, int cl)
        singmoveto(cl);
 }
 
+/* Output cap ct times or multcap with argument ct, whichever is shorter. *
+ * The length of multcap is the one of the string with ct filled in.     */
+
 /**/
 int
 tcmultout(int cap, int multcap, int ct)
 {
-    if (tccan(multcap) && (!tccan(cap) || tclen[multcap] <= tclen[cap] * ct)) {
+    if (tccan(multcap) && (!tccan(cap) || tcargcost(multcap, ct) <= tclen[cap] * ct)) {
 	tcoutarg(multcap, ct);
 	return 1;
     } else if (tccan(cap)) {
@@ -867,6 +869,20 @@ tc_rightcurs(int ct)
 
     cl = ct + vcs;
 
+/* if the characters to move across are on the screen already and
+   not part of the prompt, writing them again may be cheaper than
+   any cursor movement sequence */
+    if ((vln || vcs >= pptw) && nbuf[vln] &&
+	(tccan(TCMULTRIGHT) || tccan(TCHORIZPOS)) &&
+	ct <= (tccan(TCMULTRIGHT) ? tcargcost(TCMULTRIGHT, ct) :
+	       tcargcost(TCHORIZPOS, cl))) {
+	for (j = 0, t = nbuf[vln]; *t && j < cl; j++, t++);
+	if (j == cl) {
+	    zwrite(nbuf[vln] + vcs, ct, 1, shout);
+	    return;
+	}
+    }
+
 /* do a multright if we can - it's the most reliable */
     if (tccan(TCMULTRIGHT)) {
 	tcoutarg(TCMULTRIGHT, ct);
@@ -941,6 +957,15 @@ tcout(int cap)
     SELECT_ADD_COST(tclen[cap]);
 }
 
+/* The number of characters output for cap with argument arg. */
+
+/**/
+int
+tcargcost(int cap, int arg)
+{
+    return strlen(tgoto(tcstr[cap], arg, arg));
+}
+
 /**/
 void
 tcoutarg(int cap, int arg)
@@ -108,9 +108,33 @@ static LinkList matches, fmatches;
 
 static char **amatches;
 
-/* The number of matches. */
+/* The number of matches, and how many of them at the beginning of *
+ * amatches are already sorted (see sortmatches()).                 */
 
-static int nmatches;
+static int nmatches, msorted;
+
+/* The ends of the parts after msorted that sortmatches() has already *
+ * partitioned, nearest last.  Everything in one part sorts before    *
+ * everything in the next, so later calls need not start again.      */
+
+#define MSORTBOUNDS 64
+
+static int mbounds[MSORTBOUNDS], nmbounds;
+
+/* The matches added to matches and fmatches so far, in two hash tables *
+ * (open addressing, on the heap), so that duplicates are weeded out    *
+ * when they are added, not after sorting.                              */
+
+static char **mhtab[2];
+static int mhsize[2], mhct[2];
+
+/* The widths of the entries of amatches as they are listed, computed  *
+ * once for the array mwarr, so that showing the list again (or paging *
+ * through it) need not look at the strings again.  Sorting moves the  *
+ * entries about, so the widths are only good while msorted is mwsort. */
+
+static int *mwidths, mwct, mwsort;
+static char **mwarr;
 
 /* !=0 if we have a valid completion list. */
 
@@ -191,6 +215,26 @@ static int amenu;
 
 static int showagain = 0;
 
+/* Non-zero if building the list of matches was given up because the *
+ * user typed something.  compchk counts the calls to compaborted(),  *
+ * the terminal is polled only once every COMPCHKINT calls.           */
+
+static int compabort, compchk;
+
+#define COMPCHKINT 256
+
+/* Check if the completion code should stop collecting matches.  This *
+ * is called in the loops over directories and hash tables, so that a *
+ * key typed while a big list is built aborts the completion.         */
+
+static int
+compaborted(void)
+{
+    if (!compabort && !(++compchk % COMPCHKINT) && ttykeypending())
+	compabort = 1;
+    return compabort;
+}
+
 /* Find out if we have to insert a tab (instead of trying to complete). */
 
 /**/
@@ -323,9 +367,10 @@ reversemenucomplete(void)
 	return;
     }
     HEAPALLOC {
-	if (menucur == amatches)
+	if (menucur == amatches) {
 	    menucur = amatches + nmatches - 1;
-	else
+	    sortmatches(nmatches);
+	} else
 	    menucur--;
 	complexpect = menuce;
 	metafy_line();
@@ -757,6 +802,7 @@ do_menucmp(int lst)
     HEAPALLOC {
 	if (!*++menucur)
 	    menucur = amatches;
+	sortmatches(menucur - amatches + 1);
 	complexpect = menuce;
 	/* ... and insert it into the command line. */
 	metafy_line();
@@ -1317,6 +1363,41 @@ quotename(const char *s, char **e, char *te, int *pl)
     return buf;
 }
 
+/* Remember s in the hash table of matches (f == 0) or of fmatches  *
+ * (f == 1).  Returns zero if it was already there.  The tables live *
+ * on the heap, like the lists, and grow when they get half full.    */
+
+static int
+newmatch(int f, char *s)
+{
+    char **tab = mhtab[f];
+    int i, sz = mhsize[f];
+
+    if (2 * mhct[f] >= sz) {
+	char **otab = tab;
+	int osz = sz;
+
+	sz = osz ? 2 * osz : 256;
+	tab = (char **) hcalloc(sz * sizeof(char *));
+	for (i = 0; i < osz; i++)
+	    if (otab[i]) {
+		unsigned h = hasher(otab[i]) & (sz - 1);
+
+		while (tab[h])
+		    h = (h + 1) & (sz - 1);
+		tab[h] = otab[i];
+	    }
+	mhtab[f] = tab;
+	mhsize[f] = sz;
+    }
+    for (i = hasher(s) & (sz - 1); tab[i]; i = (i + 1) & (sz - 1))
+	if (!strcmp(tab[i], s))
+	    return 0;
+    tab[i] = s;
+    mhct[f]++;
+    return 1;
+}
+
 /* This adds a match to the list of matches.  The string to add is given   *
  * in s, the type of match is given in the global variable addwhat and     *
  * the parameter t (if not NULL) is a pointer to a hash node node which    *
@@ -1475,6 +1556,10 @@ addmatch(char *s, char *t)
 	    t = s = dupstrpfx(t, e - t);
     }
 
+    /* Ignore the string if we already have it. */
+    if (!newmatch(l == fmatches, t))
+	return;
+
     if (l == fmatches) {
 	bp = &fab;
 	ep = &fae;
@@ -1925,20 +2010,39 @@ get_ccompctl(Compctl occ, int *compadd, int incmd)
 /* Dump a hash table (without sorting).  For each element the addmatch  *
  * function is called and at the beginning the addwhat variable is set. *
  * This could be done using scanhashtable(), but this is easy and much  *
- * more efficient.                                                      */
+ * more efficient.  If addmatch() would only accept names beginning     *
+ * with a certain prefix, only those are looked at, using the sorted    *
+ * index of the table.                                                  */
 
 /**/
 void
 dumphashtable(HashTable ht, int what)
 {
-    HashNode hn;
-    int i, aw = addwhat;
+    HashNode hn, *tab;
+    char *pfx = NULL;
+    int i, n, pl = 0, aw = addwhat;
 
     addwhat = what;
 
-    for (i = 0; i < ht->hsize; i++)
-	for (hn = ht->nodes[i]; hn; hn = hn->next)
-	    addmatch(hn->nam, (char *) hn);
+    if (what == -7) {
+	if (!filecomp)
+	    pfx = fpre, pl = fpl;
+    } else if (what && !patcomp) {
+	pfx = rpre, pl = rpl;
+	if (lpre && lsuf && (i = pfxlen(rpre, lpre)) < pl)
+	    pl = i;
+    }
+    if (pl > 0) {
+	tab = gethashprefix(ht, pfx, pl, &n);
+	/* addmatch() may add commands to the table, so make a copy */
+	tab = (HashNode *) memcpy(halloc(n * sizeof(HashNode) + 1), tab,
+				  n * sizeof(HashNode));
+	for (i = 0; i < n && !compaborted(); i++)
+	    addmatch(tab[i]->nam, (char *) tab[i]);
+    } else
+	for (i = 0; i < ht->hsize && !compabort; i++)
+	    for (hn = ht->nodes[i]; hn && !compaborted(); hn = hn->next)
+		addmatch(hn->nam, (char *) hn);
     addwhat = aw;
 }
 
@@ -1973,17 +2077,18 @@ getreal(char *str)
 }
 
 /* This reads a directory and adds the files to the list of  *
- * matches.  The parameters say which files should be added. */
+ * matches.  The parameters say which files should be added. *
+ * The contents of the directory and the types of the files  *
+ * are taken from the directory cache (see hashtable.c).     */
 
 /**/
 void
 gen_matches_files(int dirs, int execs, int all)
 {
-    DIR *d;
-    struct stat buf;
+    Dircache dc;
     char *n, p[PATH_MAX], *q = NULL, *e;
     LinkList l = NULL;
-    int ns = 0, ng = opts[NULLGLOB], test, aw = addwhat;
+    int i, ns = 0, ng = opts[NULLGLOB], test, type = 0, aw = addwhat;
 
     addwhat = execs ? -8 : -5;
     opts[NULLGLOB] = 1;
@@ -1999,18 +2104,16 @@ gen_matches_files(int dirs, int execs, int all)
 	dirs = 1;
 	all = execs = 0;
     }
-    /* Open directory. */
-    if ((d = opendir((prpre && *prpre) ? prpre : "."))) {
-	/* If we search only special files, prepare a path buffer for stat. */
+    /* Get the directory. */
+    if ((dc = getdircache((prpre && *prpre) ? prpre : ".", compaborted))) {
+	/* If we search only special files, prepare a path buffer. */
 	if (!all && prpre) {
 	    strcpy(p, prpre);
 	    q = p + strlen(prpre);
 	}
-	/* Fine, now read the directory. */
-	while ((n = zreaddir(d)) && !errflag) {
-	    /* Ignore `.' and `..'. */
-	    if (n[0] == '.' && (n[1] == '\0' || (n[1] == '.' && n[2] == '\0')))
-		continue;
+	/* Fine, now look at the files (`.' and `..' are not cached). */
+	for (i = 0; i < dc->nents && !errflag && !compaborted(); i++) {
+	    n = dc->names[i];
 	    /* Ignore files beginning with `.' unless the thing we found on *
 	     * the command line also starts with a dot or GLOBDOTS is set.  */
 	    if (*n != '.' || *fpre == '.' || isset(GLOBDOTS)) {
@@ -2030,14 +2133,12 @@ gen_matches_files(int dirs, int execs, int all)
 		    /* We still have to check the file type, so prepare *
 		     * the path buffer by appending the filename.       */
 		    strcpy(q, n);
-		    /* And do the stat. */
-		    if (stat(p, &buf) < 0)
+		    /* And get the type. */
+		    if ((type = dircachetype(dc, i)) == DCT_NOSTAT)
 			continue;
 		}
-		if (all ||
-		    (dirs && (buf.st_mode & S_IFMT) == S_IFDIR) ||
-		    (execs && ((buf.st_mode & (S_IFMT | S_IEXEC))
-		      == (S_IFREG | S_IEXEC)))) {
+		if (all || (dirs && type == DCT_DIR) ||
+		    (execs && type == DCT_EXEC)) {
 		    /* If we want all files or the file has the right type... */
 		    if (*psuf) {
 			/* We have to test for a path suffix. */
@@ -2079,7 +2180,6 @@ gen_matches_files(int dirs, int execs, int all)
 		}
 	    }
 	}
-	closedir(d);
     }
     opts[NULLGLOB] = ng;
     addwhat = aw;
@@ -2128,8 +2228,10 @@ docompletion(char *s, int lst, int incmd, int untokenized)
 
 	/* Make sure we have the completion list and compctl. */
 	if(makecomplist(s, incmd, &delit, &compadd, untokenized)) {
-	    /* Error condition: feeeeeeeeeeeeep(). */
-	    feep();
+	    /* Error condition: feeeeeeeeeeeeep(), unless completion *
+	     * was given up because the user typed something.      */
+	    if (!compabort)
+		feep();
 	    clearlist = 1;
 	    goto compend;
 	}
@@ -2211,6 +2313,7 @@ makecomplist(char *s, int incmd, int *delit, int *compadd, int untokenized)
 
     os = dupstring(s);
     ol = (unsigned char *)dupstring((char *)line);
+    compabort = compchk = 0;
 
   xorrec:
 
@@ -2232,6 +2335,8 @@ makecomplist(char *s, int incmd, int *delit, int *compadd, int untokenized)
     /* Blank out the lists. */
     matches = newlinklist();
     fmatches = newlinklist();
+    mhtab[0] = mhtab[1] = NULL;
+    mhsize[0] = mhsize[1] = mhct[0] = mhct[1] = 0;
 
     /* If we don't have a compctl definition yet or we have a compctl *
      * with extended completion, get it (or the next one, resp.).     */
@@ -2611,7 +2716,7 @@ makecomplist(char *s, int incmd, int *delit, int *compadd, int untokenized)
 
 			/* The compctl -g string may contain more than *
 			 * one pattern, so we need a loop.             */
-			while (*g) {
+			while (*g && !compabort) {
 			    LinkList l = newlinklist();
 			    int ng;
 
@@ -2752,7 +2857,7 @@ makecomplist(char *s, int incmd, int *delit, int *compadd, int untokenized)
     if (cc->mask & CC_USERS)
 	/* Add user names. */
 	maketildelist();
-    if (cc->func) {
+    if (cc->func && !compabort) {
 	/* This handles the compctl -K flag. */
 	List list;
 	char **r;
@@ -2780,7 +2885,7 @@ makecomplist(char *s, int incmd, int *delit, int *compadd, int untokenized)
 	    /* This flag allows us to use read -l and -c. */
 	    inzlefunc = 1;
 	    /* Call the function. */
-	    doshfunc(list, args, 0, 1);
+	    doshfunc(cc->func, list, args, 0, 1);
 	    inzlefunc = 0;
 	    /* And get the result from the reply parameter. */
 	    if ((r = get_user_var("reply")))
@@ -2794,7 +2899,7 @@ makecomplist(char *s, int incmd, int *delit, int *compadd, int untokenized)
 	int i;
 	char *j, *jj;
 
-	for (i = 0; i < MAXJOB; i++)
+	for (i = 0; i < jobtabsize; i++)
 	    if ((jobtab[i].stat & STAT_INUSE) &&
 		jobtab[i].procs && jobtab[i].procs->text) {
 		int stopped = jobtab[i].stat & STAT_STOPPED;
@@ -2913,6 +3018,32 @@ makecomplist(char *s, int incmd, int *delit, int *compadd, int untokenized)
 	/* Add the two types of aliases. */
 	dumphashtable(aliastab, t | (cc->mask & (CC_DISCMDS|CC_EXCMDS)));
 
+    if (compabort) {
+	/* The user typed something while we were collecting the   *
+	 * matches, so forget about them and restore the old line. *
+	 * The key will be read normally when we return to zle.    */
+	wb = owb;
+	we = owe;
+	cs = ocs;
+	ll = oll;
+	strcpy((char *)line, (char *)ol);
+	offs = oloffs;
+	zsfree(rpre);
+	zsfree(rsuf);
+	zsfree(lpre);
+	zsfree(lsuf);
+	zsfree(ppre);
+	zsfree(psuf);
+	zsfree(fpre);
+	zsfree(fsuf);
+	zsfree(prpre);
+	zsfree(parampre);
+	zsfree(qparampre);
+	if (ccmain != &cc_dummy)
+	    freecompctl(ccmain);
+	return 1;
+    }
+
     /* If we have no matches, ignore fignore. */
     if (empty(matches)) {
 	matches = fmatches;
@@ -2924,7 +3055,7 @@ makecomplist(char *s, int incmd, int *delit, int *compadd, int untokenized)
     }
 
     /* Make an array from the list of matches. */
-    makearray(matches);
+    makearray(matches, 0);
     PERMALLOC {
 	amatches = arrdup(amatches);
 	if (firstm)
@@ -3003,6 +3134,7 @@ invalidatelist(void)
     if(showinglist == -2)
 	listmatches();
     if(validlist) {
+	freemwidths();
 	freearray(amatches);
 	zsfree(rpre);
 	zsfree(rsuf);
@@ -3098,11 +3230,14 @@ strbpcmp(const void *a, const void *b)
     return (int)(*aa - *bb);
 }
 
-/* Make an array from a linked list */
+/* Make an array from a linked list.  If uniq is zero, the list is *
+ * known to contain no duplicates (addmatch() makes sure of that),  *
+ * and the array is sorted only when and as far as it is needed.    *
+ * Otherwise it is sorted and the duplicates are removed here.      */
 
 /**/
 void
-makearray(LinkList l)
+makearray(LinkList l, int uniq)
 {
     char **ap, **bp, **cp;
     LinkNode nod;
@@ -3115,19 +3250,85 @@ makearray(LinkList l)
     for (nod = firstnode(l); nod; incnode(nod))
 	*ap++ = (char *)getdata(nod);
     *ap = NULL;
+    msorted = nmbounds = 0;
+
+    if (uniq) {
+	/* Sort the array. */
+	sortmatches(nmatches);
+
+	/* And delete the ones that occur more than once. */
+	for (ap = cp = amatches; *ap; ap++) {
+	    *cp++ = *ap;
+	    for (bp = ap; bp[1] && !strcmp(*ap, bp[1]); bp++);
+	    ap = bp;
+	}
+	*cp = NULL;
+	nmatches = msorted = cp - amatches;
+    }
+}
 
-    /* Now sort the array. */
-    qsort((void *) amatches, nmatches, sizeof(char *),
-	       (int (*) _((const void *, const void *)))strbpcmp);
+/* Make sure that the first n elements of amatches are sorted and in *
+ * their final places.  Menu completion usually looks only at the    *
+ * first few matches, so the array is partitioned around a pivot     *
+ * until the part holding the n'th match is small enough to sort.    *
+ * Parts wholly before n are sorted as they are split off, those     *
+ * after it are remembered in mbounds for later calls.               */
 
-    /* And delete the ones that occur more than once. */
-    for (ap = cp = amatches; *ap; ap++) {
-	*cp++ = *ap;
-	for (bp = ap; bp[1] && !strcmp(*ap, bp[1]); bp++);
-	ap = bp;
+#define MSORTCHUNK 64
+
+/**/
+void
+sortmatches(int n)
+{
+    char **a = amatches, *p;
+    int lo, hi, m, i;
+
+#define MSWAP(X, Y) (p = a[X], a[X] = a[Y], a[Y] = p)
+#define MSORT(L, H) qsort((void *) (a + (L)), (H) - (L), sizeof(char *), \
+		(int (*) _((const void *, const void *)))strbpcmp)
+    if (n > nmatches)
+	n = nmatches;
+    while (msorted < n) {
+	while (nmbounds && mbounds[nmbounds - 1] <= msorted)
+	    nmbounds--;
+	lo = msorted;
+	hi = nmbounds ? mbounds[nmbounds - 1] : nmatches;
+	/* A part that is wanted whole is just sorted. */
+	while (n < hi && hi - lo > MSORTCHUNK) {
+	    /* Use the median of the first, middle and last element as *
+	     * the pivot, so that there is something bigger after it. */
+	    m = lo + (hi - lo) / 2;
+	    if (strbpcmp(a + m, a + lo) < 0)
+		MSWAP(m, lo);
+	    if (strbpcmp(a + hi - 1, a + lo) < 0)
+		MSWAP(hi - 1, lo);
+	    if (strbpcmp(a + hi - 1, a + m) < 0)
+		MSWAP(hi - 1, m);
+	    MSWAP(lo, m);
+	    /* Move everything smaller than the pivot to the front... */
+	    for (m = lo, i = lo + 1; i < hi; i++)
+		if (strbpcmp(a + i, a + lo) < 0) {
+		    m++;
+		    MSWAP(m, i);
+		}
+	    /* ... and the pivot after it. */
+	    MSWAP(lo, m);
+	    if (m < n) {
+		/* All of the smaller part is wanted, so sort it and go *
+		 * on with what comes after the pivot.                  */
+		MSORT(lo, m);
+		lo = msorted = m + 1;
+	    } else {
+		if (nmbounds < MSORTBOUNDS)
+		    mbounds[nmbounds++] = hi;
+		hi = m + 1;
+	    }
+	}
+	MSORT(lo, hi);
+	msorted = hi;
     }
-    *cp = NULL;
-    nmatches = arrlen(amatches);
+#undef MSORT
+#undef MSWAP
 }
 
 /* Handle the case were we found more than one match. */
@@ -3395,6 +3596,7 @@ do_ambig_menu(void)
 {
     menucmp = 1;
     menucur = NULL;
+    sortmatches(1);
     do_single(amatches[0]);
     menucur = amatches;
 }
@@ -3497,17 +3699,92 @@ printfmt(char *fmt, int n, int dopr)
     return l + (cc / columns);
 }
 
-/* List the matches.  Note that the list entries are metafied. */
+/* Forget the widths of the list entries. */
+
+/**/
+void
+freemwidths(void)
+{
+    if (mwidths)
+	zfree(mwidths, mwct * sizeof(int));
+    mwidths = NULL;
+    mwarr = NULL;
+    mwct = 0;
+}
+
+/* Get the widths of the list entries, unless we already have them. */
+
+static void
+getmwidths(char **arr, int ct, int off, int nboff, int add)
+{
+    char **ap;
+    int *wp;
+
+    if (mwarr == arr && mwct == ct && mwsort == msorted)
+	return;
+    freemwidths();
+    if (ct)
+	mwidths = (int *) zalloc(ct * sizeof(int));
+    for (ap = arr, wp = mwidths; *ap; ap++)
+	*wp++ = niceztrlen(*ap + off) - nboff + add;
+    mwarr = arr;
+    mwct = ct;
+    mwsort = msorted;
+}
+
+/* Ask what to do after a page of the list has been shown.  Returns the  *
+ * number of rows to show next (negative to go back a page), or zero if *
+ * the listing should stop.                                              */
+
+static int
+listpage(char *prompt, int ct, int row, int colsz, int pg)
+{
+    int c, l;
+
+    l = printfmt(prompt, ct, 1);
+    fprintf(shout, " (%d-%d/%d)", row - pg + 1 > 0 ? row - pg + 1 : 1,
+	    row, colsz);
+    fflush(shout);
+    c = getkey(0);
+    putc('\r', shout);
+    if (l)
+	tcmultout(TCUP, TCMULTUP, l);
+    if (tccan(TCCLEAREOD))
+	tcout(TCCLEAREOD);
+    else if (tccan(TCCLEAREOL))
+	tcout(TCCLEAREOL);
+    switch (c) {
+    case ' ':
+    case '\t':
+	return lines - 1;
+    case '\n':
+    case '\r':
+	return 1;
+    case 'b':
+	return -(lines - 1);
+    case 'q':
+    case EOF:
+	return 0;
+    default:
+	/* Anything else ends the listing and is used by zle. */
+	ungetkey(c);
+	return 0;
+    }
+}
+
+/* List the matches.  Note that the list entries are metafied.  If the *
+ * list doesn't fit on the screen and LISTPROMPT is set, it is shown a *
+ * page at a time and the user may page back and forth.                */
 
 /**/
 void
 listmatches(void)
 {
     int longest = 1, fct, fw, colsz, t0, t1, ct, up, cl, xup = 0;
-    int off, boff, nboff;
+    int off, boff, nboff, *wp, pg, r0, r1, wraps = 0;
     int of = (isset(LISTTYPES) && !(haswhat & HAS_MISC));
-    char **arr, **ap, sav;
-    int nfpl, nfsl, nlpl, nlsl;
+    char **arr, **ap, sav, *lprompt = NULL;
+    int nfpl, nfsl, nlpl, nlsl, wadd;
     int listmax = getiparam("LISTMAX");
 
 #ifdef DEBUG
@@ -3545,14 +3822,17 @@ listmatches(void)
 		 (isset(ALWAYSLASTPROMPT) && !gotmult)) ||
 	(unset(ALWAYSLASTPROMPT) && gotmult);
 
+    /* The layout depends only on the widest entry, so the matches *
+     * need not be sorted before we know that they will be shown.  */
     arr = amatches;
+    wadd = (ispattern ? 0 :
+	    (!(haswhat & HAS_MISC) ? nfpl + nfsl : nlpl + nlsl));
+    getmwidths(arr, ct, off, nboff, wadd);
 
     /* Calculate the column width, the number of columns and the number
        of lines. */
-    for (ap = arr; *ap; ap++)
-	if ((cl = niceztrlen(*ap + off) - nboff +
-	     (ispattern ? 0 :
-	      (!(haswhat & HAS_MISC) ? nfpl + nfsl : nlpl + nlsl))) > longest)
+    for (t0 = 0; t0 < ct; t0++)
+	if ((cl = mwidths[t0]) > longest)
 	    longest = cl;
     if (of)
 	longest++;
@@ -3560,13 +3840,11 @@ listmatches(void)
     fw = longest + 2;
     fct = (columns + 1) / fw;
     if (fct == 0) {
-	fct = 1;
+	fct = wraps = 1;
 	colsz = ct;
 	up = colsz + nlnct - clearflag;
-	for (ap = arr; *ap; ap++)
-	    up += (niceztrlen(*ap + off) - nboff + of +
-		(ispattern ? 0 :
-		(!(haswhat & HAS_MISC) ? nfpl + nfsl : nlpl + nlsl))) / columns;
+	for (t0 = 0; t0 < ct; t0++)
+	    up += (mwidths[t0] + of) / columns;
     } else {
 	colsz = (ct + fct - 1) / fct;
 	up = colsz + nlnct - clearflag + (ct == 0);
@@ -3579,105 +3857,142 @@ listmatches(void)
 	up += xup;
     }
 
-    /* Maybe we have to ask if the user wants to see the list. */
+    /* Maybe we have to ask if the user wants to see the list, *
+     * or show it page by page.                                */
+    pg = colsz;
     if ((listmax && ct > listmax) || (!listmax && up >= lines)) {
 	int qup;
 	setterm();
-	qup = printfmt("zsh: do you wish to see all %n possibilities? ", ct, 1);
-	fflush(shout);
-	if (getzlequery() != 'y') {
+	if ((lprompt = getsparam("LISTPROMPT")) && !wraps && lines > 2) {
+	    /* Only the rows on the screen are printed. */
+	    if (!*lprompt)
+		lprompt = "--More--";
+	    pg = lines - 1 - xup;
+	    if (pg < 1)
+		pg = 1;
+	    clearflag = 0;
+	} else {
+	    lprompt = NULL;
+	    qup = printfmt("zsh: do you wish to see all %n possibilities? ",
+			   ct, 1);
+	    fflush(shout);
+	    if (getzlequery() != 'y') {
+		if (clearflag) {
+		    putc('\r', shout);
+		    tcmultout(TCUP, TCMULTUP, qup);
+		    if (tccan(TCCLEAREOD))
+			tcout(TCCLEAREOD);
+		    tcmultout(TCUP, TCMULTUP, nlnct + xup);
+		} else
+		    putc('\n', shout);
+		return;
+	    }
 	    if (clearflag) {
 		putc('\r', shout);
 		tcmultout(TCUP, TCMULTUP, qup);
 		if (tccan(TCCLEAREOD))
 		    tcout(TCCLEAREOD);
-		tcmultout(TCUP, TCMULTUP, nlnct + xup);
 	    } else
 		putc('\n', shout);
-	    return;
+	    settyinfo(&shttyinfo);
 	}
-	if (clearflag) {
-	    putc('\r', shout);
-	    tcmultout(TCUP, TCMULTUP, qup);
-	    if (tccan(TCCLEAREOD))
-		tcout(TCCLEAREOD);
-	} else
-	    putc('\n', shout);
-	settyinfo(&shttyinfo);
     }
 
-    /* Now print the matches. */
-    for (t1 = 0; t1 != colsz; t1++) {
-	ap = arr + t1;
-	if (of) {
-	    /* We have to print the file types. */
-	    while (*ap) {
-		int t2;
-		char *pb;
-		struct stat buf;
-
-		/* Build the path name for the stat. */
-		if (ispattern) {
-		    int cut = strlen(*ap) - boff;
-
-		    sav = ap[0][cut];
-		    ap[0][cut] = '\0';
-		    nicezputs(*ap + off, shout);
-		    t2 = niceztrlen(*ap + off);
-		    ap[0][cut] = sav;
-		    pb = *ap;
-		} else {
-		    nicezputs(fpre, shout);
-		    nicezputs(*ap, shout);
-		    nicezputs(fsuf, shout);
-		    t2 = nfpl + niceztrlen(*ap) + nfsl;
-		    pb = (char *) halloc((prpre ? strlen(prpre) : 0) + 3 +
-					 strlen(fpre) + strlen(*ap) + strlen(fsuf));
-		    sprintf(pb, "%s%s%s%s",
-			    (prpre && *prpre) ? prpre : "./", fpre, *ap, fsuf);
-		}
-		if (ztat(pb, &buf, 1))
-		    putc(' ', shout);
-		else
-		    /* Print the file type character. */
-		    putc(file_type(buf.st_mode), shout);
-		for (t0 = colsz; t0 && *ap; t0--, ap++);
-		if (*ap)
-		    /* And add spaces to make the columns aligned. */
-		    for (++t2; t2 < fw; t2++)
+    /* All of the list may be shown, so all of it has to be sorted. */
+    sortmatches(ct);
+    getmwidths(arr, ct, off, nboff, wadd);
+
+    /* Now print the matches, rows r0 to r1 at a time. */
+    for (r0 = 0; r0 < colsz; ) {
+	if ((r1 = r0 + pg) > colsz)
+	    r1 = colsz;
+	for (t1 = r0; t1 != r1; t1++) {
+	    ap = arr + t1;
+	    wp = mwidths + t1;
+	    if (of) {
+		/* We have to print the file types. */
+		while (*ap) {
+		    int t2 = *wp;
+		    char *pb;
+		    struct stat buf;
+
+		    /* Build the path name for the stat. */
+		    if (ispattern) {
+			int cut = strlen(*ap) - boff;
+
+			sav = ap[0][cut];
+			ap[0][cut] = '\0';
+			nicezputs(*ap + off, shout);
+			ap[0][cut] = sav;
+			pb = *ap;
+		    } else {
+			nicezputs(fpre, shout);
+			nicezputs(*ap, shout);
+			nicezputs(fsuf, shout);
+			pb = (char *) halloc((prpre ? strlen(prpre) : 0) + 3 +
+					     strlen(fpre) + strlen(*ap) +
+					     strlen(fsuf));
+			sprintf(pb, "%s%s%s%s",
+				(prpre && *prpre) ? prpre : "./",
+				fpre, *ap, fsuf);
+		    }
+		    if (ztat(pb, &buf, 1))
 			putc(' ', shout);
-	    }
-	} else
-	    while (*ap) {
-		int t2;
-
-		if (ispattern) {
-		    int cut = strlen(*ap) - boff;
-
-		    sav = ap[0][cut];
-		    ap[0][cut] = '\0';
-		    nicezputs(*ap + off, shout);
-		    t2 = niceztrlen(*ap + off);
-		    ap[0][cut] = sav;
-		} else if (!(haswhat & HAS_MISC)) {
-		    nicezputs(fpre, shout);
-		    nicezputs(*ap, shout);
-		    nicezputs(fsuf, shout);
-		    t2 = nfpl + niceztrlen(*ap) + nfsl;
-		} else {
-		    nicezputs(lpre, shout);
-		    nicezputs(*ap, shout);
-		    nicezputs(lsuf, shout);
-		    t2 = nlpl + niceztrlen(*ap) + nlsl;
+		    else
+			/* Print the file type character. */
+			putc(file_type(buf.st_mode), shout);
+		    for (t0 = colsz; t0 && *ap; t0--, ap++);
+		    wp += colsz;
+		    if (*ap)
+			/* And add spaces to make the columns aligned. */
+			for (++t2; t2 < fw; t2++)
+			    putc(' ', shout);
 		}
-		for (t0 = colsz; t0 && *ap; t0--, ap++);
-		if (*ap)
-		    for (; t2 < fw; t2++)
-			putc(' ', shout);
-	    }
-	if (t1 != colsz - 1 || !clearflag)
-	    putc('\n', shout);
+	    } else
+		while (*ap) {
+		    int t2 = *wp;
+
+		    if (ispattern) {
+			int cut = strlen(*ap) - boff;
+
+			sav = ap[0][cut];
+			ap[0][cut] = '\0';
+			nicezputs(*ap + off, shout);
+			ap[0][cut] = sav;
+		    } else if (!(haswhat & HAS_MISC)) {
+			nicezputs(fpre, shout);
+			nicezputs(*ap, shout);
+			nicezputs(fsuf, shout);
+		    } else {
+			nicezputs(lpre, shout);
+			nicezputs(*ap, shout);
+			nicezputs(lsuf, shout);
+		    }
+		    for (t0 = colsz; t0 && *ap; t0--, ap++);
+		    wp += colsz;
+		    if (*ap)
+			for (; t2 < fw; t2++)
+			    putc(' ', shout);
+		}
+	    if (t1 != colsz - 1 || !clearflag)
+		putc('\n', shout);
+	}
+	if (!lprompt || r1 == colsz)
+	    break;
+	/* Ask for the next page (or line, or the previous page). */
+	if (!(t0 = listpage(lprompt, ct, r1, colsz, r1 - r0)))
+	    break;
+	if (t0 > 0) {
+	    r0 = r1;
+	    pg = t0;
+	} else {
+	    pg = -t0;
+	    if ((r0 = r0 + t0) < 0)
+		r0 = 0;
+	}
     }
+    if (lprompt)
+	settyinfo(&shttyinfo);
     if (clearflag) {
 	/* Move the cursor up to the prompt, if always_last_prompt *
 	 * is set and all that...                                  */
@@ -3698,7 +4013,7 @@ listlist(LinkList l)
 {
     int hw = haswhat, ip = ispattern;
     char *lp = lpre, *ls = lsuf;
-    int nm = nmatches, vl = validlist;
+    int nm = nmatches, ms = msorted, nmb = nmbounds, vl = validlist;
     char **am = amatches;
     char *ex = expl;
 
@@ -3711,13 +4026,16 @@ listlist(LinkList l)
     lpre = lsuf = "";
     expl = NULL;
 
-    makearray(l);
+    makearray(l, 1);
     listmatches();
+    freemwidths();
     showinglist = 0;
 
     expl = ex;
     amatches = am;
     nmatches = nm;
+    msorted = ms;
+    nmbounds = nmb;
     validlist = vl;
     lpre = lp;
     lsuf = ls;
@@ -46,11 +46,8 @@ sizeline(int sz)
 void
 spaceinline(int ct)
 {
-    int i;
-
     sizeline(ct + ll);
-    for (i = ll; --i >= cs;)
-	line[i + ct] = line[i];
+    memmove((char *)line + cs + ct, (char *)line + cs, ll - cs);
     ll += ct;
     line[ll] = '\0';
 
@@ -67,9 +64,9 @@ shiftchars(int to, int cnt)
     else if (mark > to)
 	mark = to;
 
-    while (to + cnt < ll) {
-	line[to] = line[to + cnt];
-	to++;
+    if (to + cnt < ll) {
+	memmove((char *)line + to, (char *)line + to + cnt, ll - to - cnt);
+	to = ll - cnt;
     }
     line[ll = to] = '\0';
 }
@@ -249,7 +246,7 @@ addundo(void)
 	return;
     pf = s - line;
     for (s2 = (unsigned char *)line + ll, t2 = lastline + lastll;
-	 s2 > s && t > t2 && s2[-1] == t2[-1]; s2--, t2--);
+	 s2 > s && t2 > t && s2[-1] == t2[-1]; s2--, t2--);
     sf = line+ll - s2;
     ue = undos + (undoct = (undoct + 1) % UNDOCT);
     ue->pref = pf;
@@ -257,11 +254,15 @@ addundo(void)
     ue->len = t2 - t;
     ue->cs = lastcs;
     memcpy(ue->change = (char *)halloc(ue->len), (char *)t, ue->len);
-    if(linesz + 1 > lastlinelen) {
-	free(lastline);
-	lastline = (unsigned char *)zalloc(lastlinelen = linesz + 1);
-    }
-    memcpy((char *)lastline, (char *)line, ll);
+
+    /* Bring lastline up to date.  Only the changed part needs *
+     * copying; the unchanged tail is moved if the length of   *
+     * the line has changed, the unchanged start stays put.    */
+    if(linesz + 1 > lastlinelen)
+	lastline = (unsigned char *)realloc(lastline, lastlinelen = linesz + 1);
+    if (ll != lastll)
+	memmove((char *)lastline + ll - sf, (char *)lastline + lastll - sf, sf);
+    memcpy((char *)lastline + pf, (char *)line + pf, ll - sf - pf);
     lastll = ll;
     lastcs = cs;
 }
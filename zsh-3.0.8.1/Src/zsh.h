@@ -258,6 +258,8 @@ typedef struct cmdnam    *Cmdnam;
 typedef struct shfunc    *Shfunc;
 typedef struct builtin   *Builtin;
 typedef struct nameddir  *Nameddir;
+typedef struct parsecache *Parsecache;
+typedef struct dircache  *Dircache;
 
 typedef struct schedcmd  *Schedcmd;
 typedef struct process   *Process;
@@ -483,10 +485,17 @@ struct forcmd {			/* for/select */
 /* Cmd->args contains list of words to loop thru */
     int ntype;			/* node type                          */
     int inflag;			/* if there is an in ... clause       */
+    int parflags;		/* FORP_* flags for for -P            */
     char *name;			/* parameter to assign values to      */
     List list;			/* list to look through for each name */
+    char *parmax;		/* most iterations to run at once     */
+    char *parstat;		/* array to hold iteration statuses   */
 };
 
+/* flags for parflags in struct forcmd */
+
+#define FORP_ORDER   1		/* -o: collect output in word order   */
+
 struct casecmd {
 /* Cmd->args contains word to test */
     int ntype;			/* node type       */
@@ -569,8 +578,10 @@ struct asgment {
 /* Defintions for job table and job control */
 /********************************************/
 
-/* size of job table */
-#define MAXJOB 50
+/* The job table starts with room for MAXJOBS_ALLOC jobs, and grows *
+ * by that much at a time up to MAX_MAXJOBS.                        */
+#define MAXJOBS_ALLOC 50
+#define MAX_MAXJOBS 1000
 
 /* entry in the job table */
 
@@ -610,14 +621,25 @@ struct job {
 struct timeinfo {
     long ut;                    /* user space time   */
     long st;                    /* system space time */
+    long maxrss;                /* largest resident set size, in kilobytes */
+    long majflt;                /* page faults needing I/O                 */
+    long minflt;                /* page faults not needing I/O             */
+    long nvcsw;                 /* voluntary context switches              */
+    long nivcsw;                /* involuntary context switches            */
+    long inblock;               /* blocks read from the file system        */
+    long oublock;               /* blocks written to the file system       */
 };
 
+struct rusage;
+
 #define JOBTEXTSIZE 80
 
 /* node in job process lists */
 
 struct process {
     struct process *next;
+    struct process *pidnext;	/* next in hash chain of pids       */
+    int job;			/* number of job it belongs to      */
     pid_t pid;                  /* process id                       */
     char text[JOBTEXTSIZE];	/* text to print when 'jobs' is run */
     int status;			/* return code from waitpid/wait3() */
@@ -681,6 +703,10 @@ struct hashtable {
     int hsize;			/* size of nodes[]  (number of hash values)   */
     int ct;			/* number of elements                         */
     HashNode *nodes;		/* array of size hsize                        */
+    HashNode *sorted;		/* nodes sorted by name, see gethashprefix()  */
+    int nsorted;		/* number of elements in sorted[]             */
+    int sortsz;			/* size of sorted[]                           */
+    int sortchg;		/* changes made to sorted[] since it was made */
 
 #ifdef ZSH_HASH_DEBUG
     char *tablename;		/* string containing name of the hash table */
@@ -881,12 +907,50 @@ struct nameddir {
     int flags;			/* see below                        */
     char *dir;			/* the directory in full            */
     int diff;			/* strlen(.dir) - strlen(.nam)      */
+    Nameddir dirnext;		/* next with the same hash of .dir  */
 };
 
 /* flags for named directories */
 /* DISABLED is defined (1<<0) */
 #define ND_USERNAME	(1<<1)	/* nam is actually a username       */
 
+/* node for parse cache hash table (parsecachetab) */
+
+struct parsecache {
+    HashNode next;		/* next in hash chain               */
+    char *nam;			/* source text                      */
+    int flags;			/* CURRENTLY UNUSED                 */
+    List list;			/* permanent copy of parsed text    */
+    char *opts;			/* options in effect when parsed    */
+    Parsecache older, newer;	/* neighbours in order of last use  */
+};
+
+/* node for directory cache hash table (dircachetab) */
+
+struct dircache {
+    HashNode next;		/* next in hash chain               */
+    char *nam;			/* name of the directory            */
+    int flags;			/* CURRENTLY UNUSED                 */
+    dev_t dev;			/* device and inode of directory    */
+    ino_t ino;
+    time_t mtime;		/* its modification time            */
+    time_t rtime;		/* when it was read                 */
+    int nents;			/* number of files                  */
+    char **names;		/* their (metafied) names           */
+    char *types;		/* DCT_DIR for known directories    */
+    char *buf;			/* the space for the names          */
+    int bufsz;			/* size of buf                      */
+    int bytes;			/* memory used for this entry       */
+    Dircache older, newer;	/* neighbours in order of last use  */
+};
+
+/* types of files in the directory cache */
+#define DCT_UNKNOWN	0	/* not yet looked at                */
+#define DCT_NOSTAT	1	/* stat() failed                    */
+#define DCT_DIR		2	/* directory                        */
+#define DCT_EXEC	3	/* executable plain file            */
+#define DCT_OTHER	4	/* anything else                    */
+
 
 /* flags for controlling printing of hash table nodes */
 #define PRINT_NAMEONLY		(1<<0)
@@ -1155,6 +1219,7 @@ enum {
     MAGICEQUALSUBST,
     MAILWARNING,
     MARKDIRS,
+    MEMORYSUBST,
     MENUCOMPLETE,
     MONITOR,
     MULTIOS,